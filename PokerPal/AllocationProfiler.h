@@ -0,0 +1,333 @@
+#pragma once
+
+// Build with POKERPAL_ALLOCATION_PROFILER defined to replace the global
+// operator new and delete with counting versions. Every allocation is charged
+// to the menu command running at the time and to the innermost helper that
+// opened a PROFILE_ALLOCATIONS scope on the allocating thread, and a ranked
+// report goes to standard error on exit. Without the define, the scopes
+// compile to nothing.
+//
+// The replacement operators are defined here rather than inline, which the
+// standard forbids, so this header must only be reached from Main.cpp.
+#ifdef POKERPAL_ALLOCATION_PROFILER
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+constexpr size_t ALLOCATION_SITE_LIMIT = 64;                       // sites a report can rank
+constexpr size_t ALLOCATION_HEADER_SIZE = alignof(std::max_align_t); // holds the size in front of each block
+
+// Where allocations are charged. Sites are function-local statics that link
+// themselves into a list, so registering one never allocates.
+struct AllocationSite
+{
+    const char* name;
+    bool command;
+    std::atomic<uint64_t> calls{ 0 };
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> peakBytes{ 0 }; // most live bytes above the level at the start of a call
+    AllocationSite* next = nullptr;
+
+    AllocationSite(const char* name, bool command);
+};
+
+struct AllocationProfile
+{
+    std::atomic<AllocationSite*> sites{ nullptr };
+    std::atomic<int64_t> liveBytes{ 0 };
+    std::atomic<uint64_t> totalAllocations{ 0 };
+    std::atomic<uint64_t> totalBytes{ 0 };
+};
+
+inline AllocationProfile& getAllocationProfile()
+{
+    static AllocationProfile profile;
+    return profile;
+}
+
+inline AllocationSite::AllocationSite(const char* name, bool command)
+    : name(name), command(command)
+{
+    std::atomic<AllocationSite*>& sites = getAllocationProfile().sites;
+    next = sites.load();
+    while (!sites.compare_exchange_weak(next, this))
+    {
+    }
+}
+
+inline void raiseAtomic(std::atomic<uint64_t>& value, uint64_t candidate)
+{
+    uint64_t current = value.load(std::memory_order_relaxed);
+    while (candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+    {
+    }
+}
+
+// One call of a site. The command scope is shared, since worker threads
+// allocate on behalf of the command too; helper scopes are per thread.
+class AllocationScope
+{
+public:
+    explicit AllocationScope(AllocationSite& site)
+        : site(site), baseline(getAllocationProfile().liveBytes.load(std::memory_order_relaxed))
+    {
+        site.calls.fetch_add(1, std::memory_order_relaxed);
+        if (site.command)
+        {
+            outer = currentCommand().exchange(this);
+        }
+        else
+        {
+            outer = currentHelper();
+            currentHelper() = this;
+        }
+    }
+
+    ~AllocationScope()
+    {
+        raiseAtomic(site.peakBytes, peak.load(std::memory_order_relaxed));
+        if (site.command)
+        {
+            currentCommand().store(outer);
+        }
+        else
+        {
+            currentHelper() = outer;
+        }
+    }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+    void charge(size_t size, int64_t liveBytes)
+    {
+        site.allocations.fetch_add(1, std::memory_order_relaxed);
+        site.bytes.fetch_add(size, std::memory_order_relaxed);
+        raiseAtomic(peak, static_cast<uint64_t>(std::max<int64_t>(0, liveBytes - baseline)));
+    }
+
+    static std::atomic<AllocationScope*>& currentCommand()
+    {
+        static std::atomic<AllocationScope*> scope{ nullptr };
+        return scope;
+    }
+
+    static AllocationScope*& currentHelper()
+    {
+        thread_local AllocationScope* scope = nullptr;
+        return scope;
+    }
+
+private:
+    AllocationSite& site;
+    AllocationScope* outer = nullptr;
+    int64_t baseline;
+    std::atomic<uint64_t> peak{ 0 };
+};
+
+// Site 0 takes allocations made outside any menu command: startup, the CLI
+// modes and reading the menu choice.
+inline AllocationSite& getCommandAllocationSite(int option)
+{
+    static AllocationSite sites[] = { { "(outside commands)", true }, { "menu 1: add player", true },
+        { "menu 2: remove player", true }, { "menu 3: enter chips", true }, { "menu 4: print winnings", true },
+        { "menu 5: set pot", true }, { "menu 6: exit", true }, { "menu 7: push/fold chart", true },
+        { "menu 8: simulate hands", true }, { "menu 9: import history", true }, { "menu 10: player statistics", true },
+        { "menu 11: leaderboard", true }, { "menu 12: bulk chip entry", true } };
+
+    return sites[option > 0 && option < static_cast<int>(std::size(sites)) ? option : 0];
+}
+
+inline void recordAllocation(size_t size)
+{
+    AllocationProfile& profile = getAllocationProfile();
+    int64_t liveBytes = profile.liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + size;
+    profile.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    profile.totalBytes.fetch_add(size, std::memory_order_relaxed);
+
+    AllocationScope* command = AllocationScope::currentCommand().load(std::memory_order_relaxed);
+    if (command != nullptr)
+    {
+        command->charge(size, liveBytes);
+    }
+    else
+    {
+        AllocationSite& site = getCommandAllocationSite(0);
+        site.allocations.fetch_add(1, std::memory_order_relaxed);
+        site.bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    if (AllocationScope::currentHelper() != nullptr)
+    {
+        AllocationScope::currentHelper()->charge(size, liveBytes);
+    }
+}
+
+inline void printAllocationSites(bool commands)
+{
+    AllocationSite* ranked[ALLOCATION_SITE_LIMIT];
+    size_t count = 0;
+    for (AllocationSite* site = getAllocationProfile().sites.load(); site != nullptr && count < ALLOCATION_SITE_LIMIT; site = site->next)
+    {
+        if (site->command == commands && site->calls + site->allocations > 0)
+        {
+            ranked[count++] = site;
+        }
+    }
+    std::sort(ranked, ranked + count, [](const AllocationSite* a, const AllocationSite* b) { return a->bytes > b->bytes; });
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const AllocationSite& site = *ranked[i];
+        uint64_t calls = site.calls;
+        std::cerr << "  " << std::left << std::setw(28) << site.name << std::right << std::setw(10) << calls << " calls"
+            << std::setw(12) << site.allocations << " allocs" << std::setw(14) << site.bytes << " bytes"
+            << std::setw(12) << site.peakBytes << " peak";
+        if (calls > 0)
+        {
+            std::cerr << std::setw(10) << static_cast<double>(site.allocations) / calls << " allocs/call";
+        }
+        std::cerr << '\n';
+    }
+}
+
+inline void printAllocationProfile()
+{
+    AllocationProfile& profile = getAllocationProfile();
+    std::ios_base::fmtflags flags = std::cerr.flags();
+    std::streamsize precision = std::cerr.precision();
+
+    std::cerr << std::fixed << std::setprecision(2);
+    std::cerr << "Allocations: " << profile.totalAllocations << " (" << profile.totalBytes << " bytes), "
+        << profile.liveBytes << " bytes still live" << '\n';
+    std::cerr << "By menu command:" << '\n';
+    printAllocationSites(true);
+    std::cerr << "By helper:" << '\n';
+    printAllocationSites(false);
+
+    std::cerr.flags(flags);
+    std::cerr.precision(precision);
+}
+
+inline const bool allocationProfileReported = (std::atexit(printAllocationProfile), true);
+
+inline void* profiledAllocate(size_t size, bool throwing)
+{
+    void* block;
+    while ((block = std::malloc(size + ALLOCATION_HEADER_SIZE)) == nullptr)
+    {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+        {
+            if (throwing)
+            {
+                throw std::bad_alloc();
+            }
+            return nullptr;
+        }
+        handler();
+    }
+
+    *static_cast<size_t*>(block) = size;
+    recordAllocation(size);
+    return static_cast<char*>(block) + ALLOCATION_HEADER_SIZE;
+}
+
+inline void profiledFree(void* pointer)
+{
+    if (pointer == nullptr)
+    {
+        return;
+    }
+
+    void* block = static_cast<char*>(pointer) - ALLOCATION_HEADER_SIZE;
+    getAllocationProfile().liveBytes.fetch_sub(static_cast<int64_t>(*static_cast<size_t*>(block)), std::memory_order_relaxed);
+    std::free(block);
+}
+
+// Over-aligned blocks put the size in the alignment padding in front.
+inline void* profiledAllocateAligned(size_t size, std::align_val_t alignment, bool throwing)
+{
+    size_t align = std::max(static_cast<size_t>(alignment), ALLOCATION_HEADER_SIZE);
+    size_t total = (size + align + align - 1) / align * align;
+    void* block;
+
+#ifdef _WIN32
+    while ((block = _aligned_malloc(total, align)) == nullptr)
+#else
+    while ((block = std::aligned_alloc(align, total)) == nullptr)
+#endif
+    {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+        {
+            if (throwing)
+            {
+                throw std::bad_alloc();
+            }
+            return nullptr;
+        }
+        handler();
+    }
+
+    *static_cast<size_t*>(block) = size;
+    recordAllocation(size);
+    return static_cast<char*>(block) + align;
+}
+
+inline void profiledFreeAligned(void* pointer, std::align_val_t alignment)
+{
+    if (pointer == nullptr)
+    {
+        return;
+    }
+
+    size_t align = std::max(static_cast<size_t>(alignment), ALLOCATION_HEADER_SIZE);
+    void* block = static_cast<char*>(pointer) - align;
+    getAllocationProfile().liveBytes.fetch_sub(static_cast<int64_t>(*static_cast<size_t*>(block)), std::memory_order_relaxed);
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+void* operator new(size_t size) { return profiledAllocate(size, true); }
+void* operator new[](size_t size) { return profiledAllocate(size, true); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return profiledAllocate(size, false); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return profiledAllocate(size, false); }
+void* operator new(size_t size, std::align_val_t alignment) { return profiledAllocateAligned(size, alignment, true); }
+void* operator new[](size_t size, std::align_val_t alignment) { return profiledAllocateAligned(size, alignment, true); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return profiledAllocateAligned(size, alignment, false); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return profiledAllocateAligned(size, alignment, false); }
+
+void operator delete(void* pointer) noexcept { profiledFree(pointer); }
+void operator delete[](void* pointer) noexcept { profiledFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { profiledFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { profiledFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { profiledFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { profiledFree(pointer); }
+void operator delete(void* pointer, std::align_val_t alignment) noexcept { profiledFreeAligned(pointer, alignment); }
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept { profiledFreeAligned(pointer, alignment); }
+void operator delete(void* pointer, size_t, std::align_val_t alignment) noexcept { profiledFreeAligned(pointer, alignment); }
+void operator delete[](void* pointer, size_t, std::align_val_t alignment) noexcept { profiledFreeAligned(pointer, alignment); }
+void operator delete(void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept { profiledFreeAligned(pointer, alignment); }
+void operator delete[](void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept { profiledFreeAligned(pointer, alignment); }
+
+#define PROFILE_ALLOCATIONS(name) \
+    static AllocationSite allocationSite(name, false); \
+    AllocationScope allocationScope(allocationSite)
+#else
+#define PROFILE_ALLOCATIONS(name)
+#endif
@@ -0,0 +1,969 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Checksum.h"
+#include "HandHistory.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Persistence.h"
+
+constexpr uint32_t HISTORY_BLOCK_HANDS = 256;
+const char HISTORY_FILE_MAGIC[8] = { 'P', 'P', 'H', 'I', 'S', 'T', '0', '3' };
+const std::string BINARY_HISTORY_EXTENSION = ".pph";
+
+// Binary hand histories (.pph) are laid out as:
+//
+//   header
+//   hand blocks      up to 256 hands each, hand numbers delta-coded in a block
+//   block index      one HistoryBlockEntry per block, in hand number order
+//   dictionary       sorted player names, each a varint length and the bytes
+//   name offsets     uint64_t per player id
+//   postings         per player id, a varint count and the delta-coded ids of
+//                    the blocks that player appears in
+//   posting offsets  uint64_t per player id
+//
+// A block is one bit stream, packed LSB first. Numbers are Exp-Golomb coded
+// (EG0 unless noted), and signed ones are zigzagged first. Each hand is:
+//
+//   4 bits          seat count
+//   EG0             hand number delta
+//   1 bit [EG0]     set if the date changed, then the delta from the last date
+//   EG0             delta from the last hand's seconds since midnight
+//   per seat        the player id in just enough bits for the dictionary, then
+//                   the starting stack: 0 if it is where the player ended
+//                   their last hand in the block, 01 if it is where they
+//                   started it, else 11 and an EG4 delta from where they ended
+//   seat-count bits seats with known hole cards
+//   3 bits, EG0s    board card count and the action index of each board card,
+//                   delta-coded
+//   6 bits per card hole cards, then the board
+//   EG0, actions    action count; each action is a 3-bit type, the seat in
+//                   just enough bits for the seat count, and the amount as
+//                   EG4; folds, checks and shows first spend 1 bit on
+//                   whether they have one
+//
+// A player not yet seen in the block is predicted to start with the stack
+// coded just before theirs. The deltas and predictions restart at every
+// block, so blocks decode on their own.
+//
+// Player ids index the dictionary, which ties them back to roster names. The
+// block index assumes hand numbers ascend through the file, as they do in the
+// exports; each entry also records the date range of its block.
+//
+// Every block entry carries the CRC32C of its block's bytes (up to the next
+// block, or the block index), checked the first time the block is read. The
+// header carries one CRC32C for everything from the block index on and one
+// for itself; without those the file cannot be read at all.
+
+struct HistoryFileHeader
+{
+    char magic[8];
+    uint64_t handCount;
+    uint64_t blockCount;
+    uint64_t playerCount;
+    uint64_t blockIndexOffset;
+    uint64_t dictionaryOffset;
+    uint64_t nameOffsetsOffset;
+    uint64_t postingsOffset;
+    uint64_t postingOffsetsOffset;
+    uint32_t indexChecksum;
+    uint32_t headerChecksum; // with this field zero
+};
+
+struct HistoryBlockEntry
+{
+    uint64_t firstHandNumber;
+    uint64_t offset;
+    uint32_t earliestDate;
+    uint32_t latestDate;
+    uint32_t handCount;
+    uint32_t checksum;
+};
+
+inline void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t readVarint(const uint8_t*& in)
+{
+    uint64_t value = 0;
+    int shift = 0;
+
+    while (*in & 0x80)
+    {
+        value |= static_cast<uint64_t>(*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+
+    return value | static_cast<uint64_t>(*in++) << shift;
+}
+
+inline uint64_t zigzag(long long value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline long long unzigzag(uint64_t value)
+{
+    return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
+
+// Folds, checks and shows move no chips, so only they spend a bit on whether
+// an amount follows.
+inline bool carriesAmount(HandActionType type)
+{
+    return type != FOLDS && type != CHECKS && type != SHOWS;
+}
+
+// Bits needed for a value below `count`.
+inline int bitsBelow(uint64_t count)
+{
+    return count > 1 ? static_cast<int>(std::bit_width(count - 1)) : 0;
+}
+
+// Where each player started and ended the last hand they played in the
+// current block. Starting stacks are coded against these, and the table is
+// cleared at every block so blocks stay independently decodable.
+class StackPredictor
+{
+public:
+    struct Stacks
+    {
+        long long starting;
+        long long ending;
+    };
+
+    void clear()
+    {
+        stacks.clear();
+        lastStack = 0;
+    }
+
+    // A player not yet seen in the block is predicted to have the stack of
+    // the seat coded before them.
+    Stacks predict(uint32_t playerId) const
+    {
+        auto found = stacks.find(playerId);
+        return found != stacks.end() ? found->second : Stacks{ lastStack, lastStack };
+    }
+
+    void coded(long long stack)
+    {
+        lastStack = stack;
+    }
+
+    void update(const ParsedHand& hand, const std::array<uint32_t, MAX_HISTORY_SEATS>& seatPlayerIds)
+    {
+        std::array<long long, MAX_HISTORY_SEATS> net = hand.netResults();
+        for (int seat = 0; seat < hand.seatCount; seat++)
+        {
+            stacks[seatPlayerIds[seat]] = { hand.startingStacks[seat], hand.startingStacks[seat] + net[seat] };
+        }
+    }
+
+private:
+    std::unordered_map<uint32_t, Stacks> stacks;
+    long long lastStack = 0;
+};
+
+// Encodes the hands of one chunk into blocks. Chunks are encoded in parallel
+// and concatenated in file order.
+class HistoryEncoder
+{
+public:
+    struct Block
+    {
+        uint64_t firstHandNumber;
+        uint32_t earliestDate;
+        uint32_t latestDate;
+        uint32_t handCount;
+        size_t offset;
+        std::vector<uint32_t> playerIds;
+    };
+
+    explicit HistoryEncoder(const std::unordered_map<std::string_view, uint32_t>& playerIds)
+        : playerIds(&playerIds), playerIdBits(bitsBelow(playerIds.size()))
+    {
+    }
+
+    void addHand(const ParsedHand& hand)
+    {
+        if (blocks.empty() || blocks.back().handCount == HISTORY_BLOCK_HANDS || hand.handNumber < previousHandNumber)
+        {
+            flushBits();
+            blocks.push_back({ hand.handNumber, hand.date, hand.date, 0, bytes.size(), {} });
+            previousHandNumber = hand.handNumber;
+            previousDate = 0;
+            previousSeconds = 0;
+            predictor.clear();
+        }
+
+        Block& block = blocks.back();
+        bool dateChanged = block.handCount == 0 || hand.date != previousDate;
+
+        putBits(static_cast<uint64_t>(hand.seatCount), 4);
+        putNumber(hand.handNumber - previousHandNumber, 0);
+        putBits(dateChanged ? 1 : 0, 1);
+        if (dateChanged)
+        {
+            putNumber(zigzag(static_cast<long long>(hand.date) - previousDate), 0);
+        }
+        putNumber(zigzag(static_cast<long long>(hand.seconds) - previousSeconds), 0);
+
+        std::array<uint32_t, MAX_HISTORY_SEATS> seatPlayerIds{};
+        uint32_t holeCardSeats = 0;
+        for (int seat = 0; seat < hand.seatCount; seat++)
+        {
+            seatPlayerIds[seat] = playerIds->at(hand.seatNames[seat]);
+            putBits(seatPlayerIds[seat], playerIdBits);
+            block.playerIds.push_back(seatPlayerIds[seat]);
+
+            long long stack = hand.startingStacks[seat];
+            StackPredictor::Stacks predicted = predictor.predict(seatPlayerIds[seat]);
+            if (stack == predicted.ending)
+            {
+                putBits(0, 1);
+            }
+            else if (stack == predicted.starting)
+            {
+                putBits(0b01, 2);
+            }
+            else
+            {
+                putBits(0b11, 2);
+                putNumber(zigzag(stack - predicted.ending), 4);
+            }
+            predictor.coded(stack);
+
+            holeCardSeats |= hand.holeCards[seat][0] >= 0 ? 1u << seat : 0;
+        }
+
+        putBits(holeCardSeats, hand.seatCount);
+        putBits(static_cast<uint64_t>(hand.boardCount), 3);
+        for (int card = 0; card < hand.boardCount; card++)
+        {
+            putNumber(hand.boardActionIndex[card] - (card > 0 ? hand.boardActionIndex[card - 1] : 0), 0);
+        }
+
+        for (int seat = 0; seat < hand.seatCount; seat++)
+        {
+            if (holeCardSeats & (1u << seat))
+            {
+                putBits(static_cast<uint64_t>(hand.holeCards[seat][0]), 6);
+                putBits(static_cast<uint64_t>(hand.holeCards[seat][1]), 6);
+            }
+        }
+        for (int card = 0; card < hand.boardCount; card++)
+        {
+            putBits(static_cast<uint64_t>(hand.board[card]), 6);
+        }
+
+        int seatBits = bitsBelow(static_cast<uint64_t>(hand.seatCount));
+        putNumber(hand.actions.size(), 0);
+        for (const HandAction& action : hand.actions)
+        {
+            putBits(action.type, 3);
+            putBits(action.seat, seatBits);
+            if (!carriesAmount(action.type))
+            {
+                putBits(action.cents != 0 ? 1 : 0, 1);
+            }
+            if (carriesAmount(action.type) || action.cents != 0)
+            {
+                putNumber(zigzag(action.cents), 4);
+            }
+        }
+
+        predictor.update(hand, seatPlayerIds);
+        previousHandNumber = hand.handNumber;
+        previousDate = hand.date;
+        previousSeconds = hand.seconds;
+        block.earliestDate = std::min(block.earliestDate, hand.date);
+        block.latestDate = std::max(block.latestDate, hand.date);
+        block.handCount++;
+    }
+
+    void finish()
+    {
+        flushBits();
+        for (Block& block : blocks)
+        {
+            std::sort(block.playerIds.begin(), block.playerIds.end());
+            block.playerIds.erase(std::unique(block.playerIds.begin(), block.playerIds.end()), block.playerIds.end());
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+    std::vector<Block> blocks;
+
+private:
+    // Appends the low `count` bits of value, LSB first.
+    void putBits(uint64_t value, int count)
+    {
+        while (count > 0)
+        {
+            int taken = std::min(count, 32);
+            bitBuffer |= (value & ((uint64_t(1) << taken) - 1)) << bitCount;
+            bitCount += taken;
+            value >>= taken;
+            count -= taken;
+
+            while (bitCount >= 8)
+            {
+                bytes.push_back(static_cast<uint8_t>(bitBuffer));
+                bitBuffer >>= 8;
+                bitCount -= 8;
+            }
+        }
+    }
+
+    // Exp-Golomb code of order k: for q = (value >> k) + 1 of n + 1 bits, n
+    // zeros and a one, the low n bits of q, then the low k bits of value.
+    void putNumber(uint64_t value, int k)
+    {
+        uint64_t q = (value >> k) + 1;
+        int n = static_cast<int>(std::bit_width(q)) - 1;
+
+        putBits(0, n);
+        putBits(1, 1);
+        putBits(q, n);
+        putBits(value, k);
+    }
+
+    void flushBits()
+    {
+        if (bitCount > 0)
+        {
+            bytes.push_back(static_cast<uint8_t>(bitBuffer));
+        }
+
+        bitBuffer = 0;
+        bitCount = 0;
+    }
+
+    const std::unordered_map<std::string_view, uint32_t>* playerIds;
+    int playerIdBits;
+    StackPredictor predictor;
+    uint64_t bitBuffer = 0;
+    int bitCount = 0;
+    uint64_t previousHandNumber = 0;
+    uint32_t previousDate = 0;
+    uint32_t previousSeconds = 0;
+};
+
+// Reads what HistoryEncoder wrote. It loads up to eight bytes ahead, which
+// stays inside the file because the block index follows the last block.
+class HistoryBitReader
+{
+public:
+    explicit HistoryBitReader(const uint8_t* cursor)
+        : cursor(cursor)
+    {
+    }
+
+    uint64_t readBits(int count)
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < count; shift += 32)
+        {
+            int taken = std::min(count - shift, 32);
+            refill();
+            value |= (bitBuffer & ((uint64_t(1) << taken) - 1)) << shift;
+            bitBuffer >>= taken;
+            bitCount -= taken;
+        }
+
+        return value;
+    }
+
+    uint64_t readNumber(int k)
+    {
+        int n = 0;
+        refill();
+        while (bitBuffer == 0)
+        {
+            n += bitCount;
+            bitCount = 0;
+            refill();
+        }
+
+        int zeros = std::countr_zero(bitBuffer);
+        n += zeros;
+        bitBuffer >>= zeros;
+        bitBuffer >>= 1;
+        bitCount -= zeros + 1;
+
+        uint64_t q = (uint64_t(1) << n) | readBits(n);
+        return ((q - 1) << k) | readBits(k);
+    }
+
+private:
+    void refill()
+    {
+        while (bitCount <= 56)
+        {
+            bitBuffer |= static_cast<uint64_t>(*cursor++) << bitCount;
+            bitCount += 8;
+        }
+    }
+
+    const uint8_t* cursor;
+    uint64_t bitBuffer = 0;
+    int bitCount = 0;
+};
+
+inline void padTo8(FileWrite& out, uint64_t& offset)
+{
+    static const char ZEROS[8] = {};
+    out.add(ZEROS, (8 - offset % 8) % 8);
+    offset += (8 - offset % 8) % 8;
+}
+
+inline uint32_t checksumFrom(const FileWrite& out, uint64_t position)
+{
+    uint32_t crc = 0;
+    for (const std::vector<uint8_t>& part : out.parts)
+    {
+        uint64_t skipped = std::min<uint64_t>(position, part.size());
+        crc = crc32c(part.data() + skipped, part.size() - skipped, crc);
+        position -= skipped;
+    }
+
+    return crc;
+}
+
+// Queues the file for the persistence queue, taking over the encoded bytes.
+inline bool writeBinaryHistory(const std::string& path, const std::vector<std::string_view>& dictionary,
+    std::vector<HistoryEncoder>& encoders)
+{
+    FileWrite out;
+    out.path = path;
+
+    HistoryFileHeader header = {};
+    std::memcpy(header.magic, HISTORY_FILE_MAGIC, sizeof(header.magic));
+    header.playerCount = dictionary.size();
+    out.add(&header, sizeof(header));
+
+    uint64_t offset = sizeof(header);
+    std::vector<HistoryBlockEntry> blockIndex;
+    std::vector<std::vector<uint32_t>> postings(dictionary.size());
+    std::vector<std::vector<uint32_t>> blockChecksums(encoders.size());
+
+    parallelFor(encoders.size(), [&](size_t e)
+    {
+        const HistoryEncoder& encoder = encoders[e];
+        for (size_t b = 0; b < encoder.blocks.size(); b++)
+        {
+            uint64_t end = b + 1 < encoder.blocks.size() ? encoder.blocks[b + 1].offset : encoder.bytes.size();
+            blockChecksums[e].push_back(crc32c(encoder.bytes.data() + encoder.blocks[b].offset, end - encoder.blocks[b].offset));
+        }
+    });
+
+    for (size_t e = 0; e < encoders.size(); e++)
+    {
+        HistoryEncoder& encoder = encoders[e];
+        for (size_t b = 0; b < encoder.blocks.size(); b++)
+        {
+            const HistoryEncoder::Block& block = encoder.blocks[b];
+            for (uint32_t playerId : block.playerIds)
+            {
+                postings[playerId].push_back(static_cast<uint32_t>(blockIndex.size()));
+            }
+
+            blockIndex.push_back({ block.firstHandNumber, offset + block.offset, block.earliestDate, block.latestDate,
+                block.handCount, blockChecksums[e][b] });
+            header.handCount += block.handCount;
+        }
+
+        offset += encoder.bytes.size();
+        out.adopt(std::move(encoder.bytes));
+    }
+
+    uint64_t blocksEnd = offset;
+    padTo8(out, offset);
+    if (!blockIndex.empty())
+    {
+        // The last block runs up to the block index, padding included.
+        static const char ZEROS[8] = {};
+        blockIndex.back().checksum = crc32c(ZEROS, offset - blocksEnd, blockIndex.back().checksum);
+    }
+
+    header.blockCount = blockIndex.size();
+    header.blockIndexOffset = offset;
+    out.add(blockIndex.data(), sizeof(HistoryBlockEntry) * blockIndex.size());
+    offset += sizeof(HistoryBlockEntry) * blockIndex.size();
+
+    std::vector<uint8_t> bytes;
+    std::vector<uint64_t> nameOffsets;
+    header.dictionaryOffset = offset;
+    for (std::string_view name : dictionary)
+    {
+        nameOffsets.push_back(offset + bytes.size());
+        writeVarint(bytes, name.size());
+        bytes.insert(bytes.end(), name.begin(), name.end());
+    }
+
+    out.add(bytes.data(), bytes.size());
+    offset += bytes.size();
+    padTo8(out, offset);
+    header.nameOffsetsOffset = offset;
+    out.add(nameOffsets.data(), sizeof(uint64_t) * nameOffsets.size());
+    offset += sizeof(uint64_t) * nameOffsets.size();
+
+    bytes.clear();
+    std::vector<uint64_t> postingOffsets;
+    header.postingsOffset = offset;
+    for (const std::vector<uint32_t>& blocks : postings)
+    {
+        postingOffsets.push_back(offset + bytes.size());
+        writeVarint(bytes, blocks.size());
+
+        uint32_t previousBlock = 0;
+        for (uint32_t block : blocks)
+        {
+            writeVarint(bytes, block - previousBlock);
+            previousBlock = block;
+        }
+    }
+
+    out.add(bytes.data(), bytes.size());
+    offset += bytes.size();
+    padTo8(out, offset);
+    header.postingOffsetsOffset = offset;
+    out.add(postingOffsets.data(), sizeof(uint64_t) * postingOffsets.size());
+
+    header.indexChecksum = checksumFrom(out, header.blockIndexOffset);
+    header.headerChecksum = crc32c(&header, sizeof(header));
+    out.overwrite(0, &header, sizeof(header));
+    getPersistenceQueue().submit(std::move(out));
+
+    return true;
+}
+
+// Converts a text export into a .pph file. Names are collected in a first
+// parallel pass to build the sorted dictionary, then every chunk is encoded
+// in parallel against it.
+inline bool convertHandHistoryFile(const std::string& textPath, const std::string& binaryPath)
+{
+    MappedFile text;
+    if (!text.open(textPath))
+    {
+        std::cerr << "ERROR: Unable to read hand history '" << textPath << "'!" << '\n';
+        return false;
+    }
+
+    std::vector<HandHistoryChunk> chunks;
+    splitHandHistory(text, chunks);
+
+    std::vector<std::unordered_set<std::string_view>> chunkNames(chunks.size());
+    parallelFor(chunks.size(), [&](size_t c)
+    {
+        parseHandHistory(chunks[c].begin, chunks[c].end, chunks[c].limit, [&](const ParsedHand& hand)
+        {
+            chunkNames[c].insert(hand.seatNames.begin(), hand.seatNames.begin() + hand.seatCount);
+        });
+    });
+
+    std::vector<std::string_view> dictionary;
+    for (const std::unordered_set<std::string_view>& names : chunkNames)
+    {
+        dictionary.insert(dictionary.end(), names.begin(), names.end());
+    }
+
+    std::sort(dictionary.begin(), dictionary.end());
+    dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+
+    std::unordered_map<std::string_view, uint32_t> playerIds;
+    for (uint32_t id = 0; id < dictionary.size(); id++)
+    {
+        playerIds[dictionary[id]] = id;
+    }
+
+    std::vector<HistoryEncoder> encoders(chunks.size(), HistoryEncoder(playerIds));
+    parallelFor(chunks.size(), [&](size_t c)
+    {
+        parseHandHistory(chunks[c].begin, chunks[c].end, chunks[c].limit, [&](const ParsedHand& hand)
+        {
+            encoders[c].addHand(hand);
+        });
+
+        encoders[c].finish();
+    });
+
+    return writeBinaryHistory(binaryPath, dictionary, encoders);
+}
+
+// Read-only view of a mapped .pph file. Lookups by hand number and date binary
+// search the block index, lookups by player go through that player's block
+// postings, and only the blocks found are decoded.
+class BinaryHistory
+{
+public:
+    bool open(const std::string& path)
+    {
+        getPersistenceQueue().waitFor(path);
+        if (!file.open(path) || file.size() < sizeof(HistoryFileHeader))
+        {
+            return false;
+        }
+
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, HISTORY_FILE_MAGIC, sizeof(header.magic)) != 0
+            || header.postingOffsetsOffset + sizeof(uint64_t) * header.playerCount > file.size())
+        {
+            file.close();
+            return false;
+        }
+
+        if (!indexIntact())
+        {
+            std::cerr << "ERROR: '" << path << "' has a corrupt header or block index!" << '\n';
+            file.close();
+            return false;
+        }
+
+        blockStates = std::make_unique<std::atomic<uint8_t>[]>(header.blockCount);
+        blocks = reinterpret_cast<const HistoryBlockEntry*>(file.data() + header.blockIndexOffset);
+        nameOffsets = reinterpret_cast<const uint64_t*>(file.data() + header.nameOffsetsOffset);
+        postingOffsets = reinterpret_cast<const uint64_t*>(file.data() + header.postingOffsetsOffset);
+
+        return true;
+    }
+
+    uint64_t handCount() const { return header.handCount; }
+    uint64_t blockCount() const { return header.blockCount; }
+    uint64_t playerCount() const { return header.playerCount; }
+
+    std::string_view playerName(uint32_t playerId) const
+    {
+        const uint8_t* cursor = bytesAt(nameOffsets[playerId]);
+        uint64_t length = readVarint(cursor);
+        return std::string_view(reinterpret_cast<const char*>(cursor), length);
+    }
+
+    // Returns the id of a player, or -1 if they are not in this file.
+    long long findPlayerId(std::string_view name) const
+    {
+        uint64_t low = 0;
+        uint64_t high = header.playerCount;
+
+        while (low < high)
+        {
+            uint64_t middle = (low + high) / 2;
+            if (playerName(static_cast<uint32_t>(middle)) < name)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        return low < header.playerCount && playerName(static_cast<uint32_t>(low)) == name ? static_cast<long long>(low) : -1;
+    }
+
+    // Decodes every hand of a block, calling visit(hand, seatPlayerIds) until
+    // it returns false.
+    template <typename Visitor>
+    bool forEachHandInBlock(uint64_t blockIndex, Visitor&& visit) const
+    {
+        if (!blockIntact(blockIndex))
+        {
+            return true;
+        }
+
+        const HistoryBlockEntry& block = blocks[blockIndex];
+        HistoryBitReader bits(bytesAt(block.offset));
+        int playerIdBits = bitsBelow(header.playerCount);
+        uint64_t handNumber = block.firstHandNumber;
+        uint32_t date = 0;
+        uint32_t seconds = 0;
+
+        ParsedHand hand;
+        std::array<uint32_t, MAX_HISTORY_SEATS> seatPlayerIds{};
+        StackPredictor predictor;
+
+        for (uint32_t h = 0; h < block.handCount; h++)
+        {
+            hand.clear();
+
+            hand.seatCount = static_cast<int>(bits.readBits(4));
+            handNumber += bits.readNumber(0);
+            if (bits.readBits(1))
+            {
+                date = static_cast<uint32_t>(date + unzigzag(bits.readNumber(0)));
+            }
+            seconds = static_cast<uint32_t>(seconds + unzigzag(bits.readNumber(0)));
+
+            hand.handNumber = handNumber;
+            hand.date = date;
+            hand.seconds = seconds;
+
+            for (int seat = 0; seat < hand.seatCount; seat++)
+            {
+                seatPlayerIds[seat] = static_cast<uint32_t>(bits.readBits(playerIdBits));
+                hand.seatNames[seat] = playerName(seatPlayerIds[seat]);
+
+                StackPredictor::Stacks predicted = predictor.predict(seatPlayerIds[seat]);
+                long long stack = predicted.ending;
+                if (bits.readBits(1))
+                {
+                    stack = bits.readBits(1) ? predicted.ending + unzigzag(bits.readNumber(4)) : predicted.starting;
+                }
+
+                hand.startingStacks[seat] = stack;
+                predictor.coded(stack);
+            }
+
+            uint32_t holeCardSeats = static_cast<uint32_t>(bits.readBits(hand.seatCount));
+            hand.boardCount = static_cast<int>(bits.readBits(3));
+            for (int card = 0; card < hand.boardCount; card++)
+            {
+                hand.boardActionIndex[card] = static_cast<uint16_t>((card > 0 ? hand.boardActionIndex[card - 1] : 0)
+                    + bits.readNumber(0));
+            }
+
+            for (int seat = 0; seat < hand.seatCount; seat++)
+            {
+                if (holeCardSeats & (1u << seat))
+                {
+                    int8_t firstCard = static_cast<int8_t>(bits.readBits(6));
+                    hand.holeCards[seat] = { firstCard, static_cast<int8_t>(bits.readBits(6)) };
+                }
+            }
+            for (int card = 0; card < hand.boardCount; card++)
+            {
+                hand.board[card] = static_cast<int8_t>(bits.readBits(6));
+            }
+
+            int seatBits = bitsBelow(static_cast<uint64_t>(hand.seatCount));
+            uint64_t actionCount = bits.readNumber(0);
+            for (uint64_t a = 0; a < actionCount; a++)
+            {
+                HandActionType type = static_cast<HandActionType>(bits.readBits(3));
+                uint8_t seat = static_cast<uint8_t>(bits.readBits(seatBits));
+                bool hasAmount = carriesAmount(type) || bits.readBits(1);
+                long long cents = hasAmount ? unzigzag(bits.readNumber(4)) : 0;
+                hand.actions.push_back({ seat, type, cents });
+            }
+
+            predictor.update(hand, seatPlayerIds);
+            if (!visit(static_cast<const ParsedHand&>(hand), static_cast<const std::array<uint32_t, MAX_HISTORY_SEATS>&>(seatPlayerIds)))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool findHand(uint64_t handNumber, ParsedHand& result) const
+    {
+        const HistoryBlockEntry* end = blocks + header.blockCount;
+        const HistoryBlockEntry* next = std::upper_bound(blocks, end, handNumber,
+            [](uint64_t number, const HistoryBlockEntry& block) { return number < block.firstHandNumber; });
+
+        if (next == blocks)
+        {
+            return false;
+        }
+
+        bool found = false;
+        forEachHandInBlock(next - blocks - 1, [&](const ParsedHand& hand, const std::array<uint32_t, MAX_HISTORY_SEATS>&)
+        {
+            if (hand.handNumber == handNumber)
+            {
+                result = hand;
+                found = true;
+            }
+
+            return !found && hand.handNumber < handNumber;
+        });
+
+        return found;
+    }
+
+    template <typename Visitor>
+    void forEachHandOfPlayer(std::string_view name, Visitor&& visit) const
+    {
+        long long playerId = findPlayerId(name);
+        if (playerId < 0)
+        {
+            return;
+        }
+
+        const uint8_t* cursor = bytesAt(postingOffsets[playerId]);
+        uint64_t blockCount = readVarint(cursor);
+        uint64_t blockIndex = 0;
+
+        for (uint64_t b = 0; b < blockCount; b++)
+        {
+            blockIndex += readVarint(cursor);
+            bool keepGoing = forEachHandInBlock(blockIndex, [&](const ParsedHand& hand, const std::array<uint32_t, MAX_HISTORY_SEATS>& seatPlayerIds)
+            {
+                for (int seat = 0; seat < hand.seatCount; seat++)
+                {
+                    if (seatPlayerIds[seat] == playerId)
+                    {
+                        return visit(hand, seat);
+                    }
+                }
+
+                return true;
+            });
+
+            if (!keepGoing)
+            {
+                return;
+            }
+        }
+    }
+
+    // Only blocks whose date range covers the date are decoded. Blocks are
+    // written in date order, so the first candidate is found by binary
+    // search and the scan stops at the first block that starts later.
+    template <typename Visitor>
+    void forEachHandOnDate(uint32_t date, Visitor&& visit) const
+    {
+        const HistoryBlockEntry* end = blocks + header.blockCount;
+        const HistoryBlockEntry* first = std::lower_bound(blocks, end, date,
+            [](const HistoryBlockEntry& block, uint32_t wanted) { return block.latestDate < wanted; });
+
+        for (const HistoryBlockEntry* block = first; block != end && block->earliestDate <= date; ++block)
+        {
+            bool keepGoing = forEachHandInBlock(block - blocks, [&](const ParsedHand& hand, const std::array<uint32_t, MAX_HISTORY_SEATS>&)
+            {
+                return hand.date != date || visit(hand);
+            });
+
+            if (!keepGoing)
+            {
+                return;
+            }
+        }
+    }
+
+    // Checks a block against its checksum the first time anyone reads it. A
+    // corrupt block is reported once and skipped by every reader.
+    bool blockIntact(uint64_t blockIndex) const
+    {
+        uint8_t state = blockStates[blockIndex].load(std::memory_order_relaxed);
+        if (state == BLOCK_UNCHECKED)
+        {
+            const HistoryBlockEntry& block = blocks[blockIndex];
+            uint64_t end = blockIndex + 1 < header.blockCount ? blocks[blockIndex + 1].offset : header.blockIndexOffset;
+            bool intact = block.offset <= end && end <= header.blockIndexOffset
+                && crc32c(bytesAt(block.offset), end - block.offset) == block.checksum;
+
+            state = intact ? BLOCK_INTACT : BLOCK_CORRUPT;
+            if (blockStates[blockIndex].exchange(state, std::memory_order_relaxed) == BLOCK_UNCHECKED && !intact)
+            {
+                std::cerr << "WARNING: Skipped corrupt hand history block " << blockIndex << " (from hand #"
+                    << block.firstHandNumber << ")." << '\n';
+            }
+        }
+
+        return state == BLOCK_INTACT;
+    }
+
+private:
+    enum BlockState : uint8_t { BLOCK_UNCHECKED, BLOCK_INTACT, BLOCK_CORRUPT };
+
+    bool indexIntact() const
+    {
+        HistoryFileHeader zeroed = header;
+        zeroed.headerChecksum = 0;
+
+        return crc32c(&zeroed, sizeof(zeroed)) == header.headerChecksum
+            && header.blockIndexOffset <= file.size()
+            && crc32c(bytesAt(header.blockIndexOffset), file.size() - header.blockIndexOffset) == header.indexChecksum;
+    }
+
+    const uint8_t* bytesAt(uint64_t offset) const
+    {
+        return reinterpret_cast<const uint8_t*>(file.data()) + offset;
+    }
+
+    MappedFile file;
+    HistoryFileHeader header = {};
+    std::unique_ptr<std::atomic<uint8_t>[]> blockStates;
+    const HistoryBlockEntry* blocks = nullptr;
+    const uint64_t* nameOffsets = nullptr;
+    const uint64_t* postingOffsets = nullptr;
+};
+
+// Handles "--history <file.pph> hand <number> | player <name> | date <yyyy-mm-dd>".
+inline int runHistoryQuery(const std::string& path, const std::string& queryType, const std::string& value)
+{
+    BinaryHistory history;
+    if (!history.open(path))
+    {
+        std::cerr << "ERROR: '" << path << "' is not a binary hand history!" << '\n';
+        return 1;
+    }
+
+    if (queryType == "hand")
+    {
+        ParsedHand hand;
+        if (!history.findHand(std::stoull(value), hand))
+        {
+            std::cerr << "ERROR: Hand #" << value << " not found!" << '\n';
+            return 1;
+        }
+
+        printHandText(hand, std::cout);
+    }
+    else if (queryType == "player")
+    {
+        long long handCount = 0;
+        long long netCents = 0;
+
+        history.forEachHandOfPlayer(value, [&](const ParsedHand& hand, int seat)
+        {
+            handCount++;
+            netCents += hand.netResults()[seat];
+            return true;
+        });
+
+        std::cout << value << ": " << handCount << " hands, net $" << netCents / 100.0 << '\n';
+    }
+    else if (queryType == "date" && value.size() == 10)
+    {
+        uint32_t date = parseDigits(value.substr(0, 4)) * 10000 + parseDigits(value.substr(5, 2)) * 100
+            + parseDigits(value.substr(8, 2));
+
+        history.forEachHandOnDate(date, [&](const ParsedHand& hand)
+        {
+            printHandText(hand, std::cout);
+            std::cout << '\n';
+            return true;
+        });
+    }
+    else
+    {
+        std::cerr << "ERROR: Unknown history query '" << queryType << "'!" << '\n';
+        return 1;
+    }
+
+    return 0;
+}
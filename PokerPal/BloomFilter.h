@@ -0,0 +1,113 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+constexpr int BLOOM_PROBES = 8;
+constexpr size_t BLOOM_COUNTERS_PER_KEY = 16;
+constexpr size_t BLOOM_COUNTERS_PER_BLOCK = 128;
+
+// Blocked counting Bloom filter. Each key hashes to one 64-byte block (one
+// cache line) and sets all its probes inside it as 4-bit counters, so a
+// lookup touches a single line and removals just decrement. A counter that
+// reaches 15 stays there, since its true count is no longer known.
+class CountingBloomFilter
+{
+public:
+    explicit CountingBloomFilter(size_t capacity = 0)
+    {
+        reset(capacity);
+    }
+
+    // Empties the filter and sizes it for `capacity` keys.
+    void reset(size_t capacity)
+    {
+        keyCapacity = std::max<size_t>(capacity, 1024);
+        blocks.assign((keyCapacity * BLOOM_COUNTERS_PER_KEY + BLOOM_COUNTERS_PER_BLOCK - 1) / BLOOM_COUNTERS_PER_BLOCK, Block{});
+        keyCount = 0;
+    }
+
+    size_t size() const { return keyCount; }
+    size_t capacity() const { return keyCapacity; }
+
+    void insert(std::string_view key)
+    {
+        forEachProbe(key, [&](size_t block, unsigned counter)
+        {
+            uint8_t& pair = blocks[block].counters[counter / 2];
+            unsigned shift = (counter % 2) * 4;
+            if (((pair >> shift) & 0xF) != 0xF)
+            {
+                pair += static_cast<uint8_t>(1 << shift);
+            }
+        });
+
+        keyCount++;
+    }
+
+    // Only call this for keys that were inserted.
+    void erase(std::string_view key)
+    {
+        forEachProbe(key, [&](size_t block, unsigned counter)
+        {
+            uint8_t& pair = blocks[block].counters[counter / 2];
+            unsigned shift = (counter % 2) * 4;
+            unsigned value = (pair >> shift) & 0xF;
+            if (value != 0 && value != 0xF)
+            {
+                pair -= static_cast<uint8_t>(1 << shift);
+            }
+        });
+
+        keyCount -= keyCount > 0 ? 1 : 0;
+    }
+
+    // False means the key was never inserted; true means it probably was.
+    bool mayContain(std::string_view key) const
+    {
+        bool present = true;
+        forEachProbe(key, [&](size_t block, unsigned counter)
+        {
+            present &= ((blocks[block].counters[counter / 2] >> ((counter % 2) * 4)) & 0xF) != 0;
+        });
+
+        return present;
+    }
+
+private:
+    struct alignas(64) Block
+    {
+        uint8_t counters[BLOOM_COUNTERS_PER_BLOCK / 2];
+    };
+
+    // FNV-1a with a final avalanche. The high half picks the block and the
+    // low half seeds double hashing for the probes within it.
+    template <typename Function>
+    void forEachProbe(std::string_view key, Function function) const
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : key)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 33;
+
+        size_t block = static_cast<size_t>(((hash >> 32) * blocks.size()) >> 32);
+        uint32_t probe = static_cast<uint32_t>(hash);
+        uint32_t step = (probe >> 16) | 1;
+
+        for (int i = 0; i < BLOOM_PROBES; i++)
+        {
+            function(block, probe % BLOOM_COUNTERS_PER_BLOCK);
+            probe += step;
+        }
+    }
+
+    std::vector<Block> blocks;
+    size_t keyCount = 0;
+    size_t keyCapacity = 0;
+};
@@ -0,0 +1,213 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "EventLog.h"
+#include "Parallel.h"
+#include "PokerPal.h"
+#include "Tracing.h"
+
+constexpr size_t BULK_CHIP_ROWS_PER_TASK = 256;
+
+// One row of bulk chip entry: "name white red blue green black".
+struct ChipRow
+{
+    int line = 0;
+    std::string_view name;
+    int chips[5] = {};
+    int playerIndex = -1;
+    std::string error;
+};
+
+// Splits a row into its name and five counts, recording what is wrong with
+// it instead. Touches nothing shared, so rows can be parsed side by side.
+inline void parseChipRow(std::string_view text, ChipRow& row)
+{
+    std::string_view fields[7];
+    int fieldCount = 0;
+
+    size_t position = 0;
+    while (fieldCount < 7)
+    {
+        size_t start = text.find_first_not_of(" \t\r", position);
+        if (start == std::string_view::npos)
+        {
+            break;
+        }
+        size_t end = std::min(text.find_first_of(" \t\r", start), text.size());
+        fields[fieldCount++] = text.substr(start, end - start);
+        position = end;
+    }
+
+    if (fieldCount != 6)
+    {
+        row.error = "expected a name and 5 chip counts.";
+        return;
+    }
+
+    row.name = fields[0];
+    for (int i = 0; i < 5; i++)
+    {
+        std::string_view field = fields[i + 1];
+        auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), row.chips[i]);
+
+        if (error != std::errc() || end != field.data() + field.size() || row.chips[i] < 0)
+        {
+            row.error = "'" + std::string(field) + "' is not a valid number of " + CHIP_COLORS[i] + " chips.";
+            return;
+        }
+    }
+}
+
+// Parses and checks every row at once: each must name a loaded player, once,
+// with five whole, non-negative counts. Returns false if any row fails,
+// with the reason left on each failing row.
+inline bool validateChipRows(std::vector<ChipRow>& rows, const std::vector<std::string_view>& lines)
+{
+    TRACE_SPAN("validateChipRows");
+
+    // Built up front so the workers only read it.
+    std::unordered_map<std::string_view, int> rosterIndex;
+    rosterIndex.reserve(playerList.size());
+    for (int i = 1; i < playerList.size(); i++)
+    {
+        rosterIndex.emplace(playerList[i].name, i);
+    }
+
+    size_t taskCount = (rows.size() + BULK_CHIP_ROWS_PER_TASK - 1) / BULK_CHIP_ROWS_PER_TASK;
+    parallelFor(taskCount, [&](size_t task)
+    {
+        size_t end = std::min(rows.size(), (task + 1) * BULK_CHIP_ROWS_PER_TASK);
+        for (size_t r = task * BULK_CHIP_ROWS_PER_TASK; r < end; r++)
+        {
+            parseChipRow(lines[r], rows[r]);
+            if (rows[r].error.empty())
+            {
+                auto found = rosterIndex.find(rows[r].name);
+                rows[r].playerIndex = found == rosterIndex.end() ? -1 : found->second;
+            }
+        }
+    });
+
+    // Suggestions and repeats need shared state, so they are checked here.
+    bool valid = true;
+    std::unordered_map<int, int> firstLine;
+    for (ChipRow& row : rows)
+    {
+        if (row.error.empty() && row.playerIndex < 0)
+        {
+            row.error = "player '" + std::string(row.name) + "' not found." + suggestPlayerNames(std::string(row.name));
+        }
+        else if (row.error.empty())
+        {
+            auto [first, inserted] = firstLine.emplace(row.playerIndex, row.line);
+            if (!inserted)
+            {
+                row.error = "'" + std::string(row.name) + "' was already entered on row " + std::to_string(first->second) + ".";
+            }
+        }
+
+        valid = valid && row.error.empty();
+    }
+
+    return valid;
+}
+
+// Reads rows until a blank line or the end of input. A pasted block arrives
+// as one burst of lines and is taken whole.
+inline std::vector<std::string> readChipRows()
+{
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(std::cin, line) && line.find_first_not_of(" \t\r") != std::string::npos)
+    {
+        lines.push_back(std::move(line));
+    }
+
+    return lines;
+}
+
+// Takes every player's counts in one go. Nothing is changed until every row
+// has passed. Rows that fail are all listed together and asked for again,
+// while the rows that passed are kept, so only the failures need retyping; a
+// corrected row for a player already kept replaces their earlier row.
+// Returns the number of players updated.
+inline int runBulkChipEntry()
+{
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::cout << "Enter one row per player as 'name white red blue green black', or paste a block of rows." << '\n';
+    std::cout << "Finish with a blank line:" << '\n';
+
+    std::map<int, std::array<int, 5>> accepted; // by player index
+    while (true)
+    {
+        std::vector<std::string> text = readChipRows();
+        if (text.empty())
+        {
+            std::cout << "No chip amounts were changed." << '\n';
+            return 0;
+        }
+
+        std::vector<std::string_view> lines(text.begin(), text.end());
+        std::vector<ChipRow> rows(lines.size());
+        for (size_t r = 0; r < rows.size(); r++)
+        {
+            rows[r].line = static_cast<int>(r + 1);
+        }
+
+        bool valid = validateChipRows(rows, lines);
+        for (const ChipRow& row : rows)
+        {
+            if (row.error.empty())
+            {
+                std::copy(std::begin(row.chips), std::end(row.chips), accepted[row.playerIndex].begin());
+            }
+        }
+
+        if (valid)
+        {
+            break;
+        }
+
+        // Printed directly rather than through the event log, which would cut
+        // long suggestions short and drop rows past its ring's capacity.
+        flushEventLog();
+        int errorCount = 0;
+        for (const ChipRow& row : rows)
+        {
+            if (!row.error.empty())
+            {
+                std::cerr << "ERROR: Row " << row.line << ": " << row.error << '\n';
+                errorCount++;
+            }
+        }
+
+        std::cout << errorCount << " of " << rows.size() << " row(s) have errors, so no chip amounts were changed yet." << '\n';
+        std::cout << "The other " << accepted.size() << " player(s) are kept. Enter the corrected rows, or a blank line to cancel:" << '\n';
+    }
+
+    long long totalCents = 0;
+    for (const auto& [playerIndex, chips] : accepted)
+    {
+        Player& player = playerList[playerIndex];
+        player.whiteChips = chips[0];
+        player.redChips = chips[1];
+        player.blueChips = chips[2];
+        player.greenChips = chips[3];
+        player.blackChips = chips[4];
+        player.chipsEntered = true;
+        totalCents += calculateWinningsCents(player);
+    }
+
+    std::cout << "Entered chips for " << accepted.size() << " player(s), totalling $" << totalCents / 100.0 << "." << '\n';
+    return static_cast<int>(accepted.size());
+}
@@ -0,0 +1,307 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+constexpr int NUM_RANKS = 13;
+constexpr int NUM_SUITS = 4;
+constexpr int DECK_SIZE = 52;
+constexpr int NUM_HAND_CLASSES = 169;
+constexpr int NUM_HOLE_COMBOS = 1326;
+constexpr uint32_t RANK_MASK = 0x1FFF;
+
+const char RANK_CHARS[] = "23456789TJQKA";
+const char SUIT_CHARS[] = "cdhs";
+
+enum HandCategory
+{
+    HIGH_CARD, ONE_PAIR, TWO_PAIR, THREE_OF_A_KIND, STRAIGHT, FLUSH,
+    FULL_HOUSE, FOUR_OF_A_KIND, STRAIGHT_FLUSH
+};
+
+// A card is encoded as suit * 13 + rank (rank 0 = deuce, 12 = ace), so a set
+// of cards fits in a 64-bit mask with one 13-bit lane per suit.
+inline int cardRank(int card) { return card % NUM_RANKS; }
+inline int cardSuit(int card) { return card / NUM_RANKS; }
+inline int makeCard(int rank, int suit) { return suit * NUM_RANKS + rank; }
+inline uint64_t cardMask(int card) { return 1ULL << card; }
+
+inline std::string cardToString(int card)
+{
+    return { RANK_CHARS[cardRank(card)], SUIT_CHARS[cardSuit(card)] };
+}
+
+// Parses cards written like "Ah" or "Td", returning -1 if the text is invalid.
+inline int parseCard(const char* text)
+{
+    int rank = -1;
+    int suit = -1;
+
+    for (int r = 0; r < NUM_RANKS; r++)
+    {
+        if (RANK_CHARS[r] == text[0])
+        {
+            rank = r;
+        }
+    }
+
+    for (int s = 0; s < NUM_SUITS && rank >= 0; s++)
+    {
+        if (SUIT_CHARS[s] == text[1])
+        {
+            suit = s;
+        }
+    }
+
+    return suit < 0 ? -1 : makeCard(rank, suit);
+}
+
+inline int highestBit(uint32_t mask)
+{
+    return 31 - std::countl_zero(mask);
+}
+
+// Keeps only the highest `count` ranks set in the mask.
+inline uint32_t keepTopRanks(uint32_t mask, int count)
+{
+    while (std::popcount(mask) > count)
+    {
+        mask &= mask - 1;
+    }
+
+    return mask;
+}
+
+// Returns the rank of the top card of the best straight, or -1 if none.
+inline int straightHighRank(uint32_t ranks)
+{
+    uint32_t shifted = (ranks << 1) | (ranks >> 12); // bit 0 is the ace playing low
+    uint32_t runs = shifted & (shifted >> 1) & (shifted >> 2) & (shifted >> 3) & (shifted >> 4);
+
+    return runs == 0 ? -1 : highestBit(runs) + 3;
+}
+
+// Scores the best five-card hand in a mask of five to seven cards. Higher
+// scores win: the category sits in the top bits, then the ranks that made
+// it, then the kickers.
+inline uint32_t evaluateHand(uint64_t cards)
+{
+    const uint32_t s0 = static_cast<uint32_t>(cards) & RANK_MASK;
+    const uint32_t s1 = static_cast<uint32_t>(cards >> 13) & RANK_MASK;
+    const uint32_t s2 = static_cast<uint32_t>(cards >> 26) & RANK_MASK;
+    const uint32_t s3 = static_cast<uint32_t>(cards >> 39) & RANK_MASK;
+    const uint32_t ranks = s0 | s1 | s2 | s3;
+
+    uint32_t flushRanks = 0;
+    for (uint32_t suitRanks : { s0, s1, s2, s3 })
+    {
+        if (std::popcount(suitRanks) >= 5)
+        {
+            flushRanks = suitRanks;
+        }
+    }
+
+    if (flushRanks != 0)
+    {
+        int straightFlush = straightHighRank(flushRanks);
+        if (straightFlush >= 0)
+        {
+            return (STRAIGHT_FLUSH << 26) | (straightFlush << 13);
+        }
+    }
+
+    const uint32_t quads = s0 & s1 & s2 & s3;
+    const uint32_t tripsOrBetter = (s0 & s1 & s2) | (s0 & s1 & s3) | (s0 & s2 & s3) | (s1 & s2 & s3);
+    const uint32_t pairsOrBetter = (s0 & s1) | (s0 & s2) | (s0 & s3) | (s1 & s2) | (s1 & s3) | (s2 & s3);
+    const uint32_t trips = tripsOrBetter & ~quads;
+    const uint32_t pairs = pairsOrBetter & ~tripsOrBetter;
+
+    if (quads != 0)
+    {
+        int quadRank = highestBit(quads);
+        return (FOUR_OF_A_KIND << 26) | (quadRank << 13) | keepTopRanks(ranks & ~quads, 1);
+    }
+
+    if (trips != 0 && (std::popcount(trips) >= 2 || pairs != 0))
+    {
+        int tripRank = highestBit(trips);
+        uint32_t remaining = (trips & ~(1u << tripRank)) | pairs;
+        return (FULL_HOUSE << 26) | (tripRank << 13) | keepTopRanks(remaining, 1);
+    }
+
+    if (flushRanks != 0)
+    {
+        return (FLUSH << 26) | keepTopRanks(flushRanks, 5);
+    }
+
+    int straight = straightHighRank(ranks);
+    if (straight >= 0)
+    {
+        return (STRAIGHT << 26) | (straight << 13);
+    }
+
+    if (trips != 0)
+    {
+        return (THREE_OF_A_KIND << 26) | (highestBit(trips) << 13) | keepTopRanks(ranks & ~trips, 2);
+    }
+
+    if (std::popcount(pairs) >= 2)
+    {
+        uint32_t topPairs = keepTopRanks(pairs, 2);
+        return (TWO_PAIR << 26) | (topPairs << 13) | keepTopRanks(ranks & ~topPairs, 1);
+    }
+
+    if (pairs != 0)
+    {
+        return (ONE_PAIR << 26) | (highestBit(pairs) << 13) | keepTopRanks(ranks & ~pairs, 3);
+    }
+
+    return (HIGH_CARD << 26) | keepTopRanks(ranks, 5);
+}
+
+// Starting hands are grouped into the 169 classes of a 13x13 chart with aces
+// in the top-left corner: pairs on the diagonal, suited hands above it and
+// offsuit hands below it.
+inline int handClassIndex(int highRank, int lowRank, bool suited)
+{
+    if (highRank < lowRank)
+    {
+        std::swap(highRank, lowRank);
+    }
+
+    int high = NUM_RANKS - 1 - highRank;
+    int low = NUM_RANKS - 1 - lowRank;
+
+    return suited ? high * NUM_RANKS + low : low * NUM_RANKS + high;
+}
+
+inline int handClassIndex(int card1, int card2)
+{
+    return handClassIndex(cardRank(card1), cardRank(card2), cardSuit(card1) == cardSuit(card2));
+}
+
+inline bool isPairClass(int handClass) { return handClass / NUM_RANKS == handClass % NUM_RANKS; }
+inline bool isSuitedClass(int handClass) { return handClass / NUM_RANKS < handClass % NUM_RANKS; }
+
+inline int handClassComboCount(int handClass)
+{
+    return isPairClass(handClass) ? 6 : (isSuitedClass(handClass) ? 4 : 12);
+}
+
+inline std::string handClassName(int handClass)
+{
+    int row = handClass / NUM_RANKS;
+    int column = handClass % NUM_RANKS;
+    char high = RANK_CHARS[NUM_RANKS - 1 - std::min(row, column)];
+    char low = RANK_CHARS[NUM_RANKS - 1 - std::max(row, column)];
+
+    if (row == column)
+    {
+        return { high, low };
+    }
+
+    return { high, low, isSuitedClass(handClass) ? 's' : 'o' };
+}
+
+struct HoleCards
+{
+    uint8_t first;
+    uint8_t second;
+};
+
+// Every specific two-card combo of every hand class (at most 12 per class).
+struct HandClassCombos
+{
+    std::array<std::array<HoleCards, 12>, NUM_HAND_CLASSES> combos;
+    std::array<uint8_t, NUM_HAND_CLASSES> counts;
+
+    HandClassCombos()
+        : combos(), counts()
+    {
+        for (int card1 = 0; card1 < DECK_SIZE; card1++)
+        {
+            for (int card2 = card1 + 1; card2 < DECK_SIZE; card2++)
+            {
+                int handClass = handClassIndex(card1, card2);
+                combos[handClass][counts[handClass]++] = { static_cast<uint8_t>(card1), static_cast<uint8_t>(card2) };
+            }
+        }
+    }
+};
+
+inline const HandClassCombos& getHandClassCombos()
+{
+    static const HandClassCombos handClassCombos;
+    return handClassCombos;
+}
+
+// xoshiro256** generator with an unbiased bounded draw (Lemire's method), used
+// for Monte Carlo equity and dealing where std::mt19937 is needlessly slow.
+class FastRng
+{
+public:
+    explicit FastRng(uint64_t seed)
+    {
+        for (uint64_t& word : state)
+        {
+            seed += 0x9E3779B97F4A7C15ULL; // splitmix64 to spread the seed
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next()
+    {
+        uint64_t result = std::rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = std::rotl(state[3], 45);
+
+        return result;
+    }
+
+    // Uniform integer in [0, range).
+    uint32_t bounded(uint32_t range)
+    {
+        uint64_t product = (next() >> 32) * range;
+        uint32_t low = static_cast<uint32_t>(product);
+
+        if (low < range)
+        {
+            uint32_t threshold = (0u - range) % range;
+            while (low < threshold)
+            {
+                product = (next() >> 32) * range;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+
+        return static_cast<uint32_t>(product >> 32);
+    }
+
+private:
+    uint64_t state[4];
+};
+
+// Draws a card that is not already in `usedCards` and marks it as used.
+inline int drawCard(FastRng& rng, uint64_t& usedCards)
+{
+    int card;
+    do
+    {
+        card = static_cast<int>(rng.bounded(DECK_SIZE));
+    } while (usedCards & cardMask(card));
+
+    usedCards |= cardMask(card);
+    return card;
+}
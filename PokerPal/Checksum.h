@@ -0,0 +1,308 @@
+#pragma once
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define POKERPAL_CRC32C_HARDWARE
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define POKERPAL_TARGET_SSE42
+#else
+#define POKERPAL_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78; // Castagnoli, bit-reversed
+constexpr size_t CRC32C_STRIPE = 8192;             // bytes per stream when three run side by side
+constexpr size_t TEXT_BLOCK_LINES = 1024;
+
+const std::string TEXT_BLOCK_MARKER = "#crc32c ";
+
+// Multiplies two bit-reversed polynomials modulo the CRC32C polynomial.
+// a must not be zero.
+inline uint32_t crc32cMultiply(uint32_t a, uint32_t b)
+{
+    uint32_t product = 0;
+    for (uint32_t bit = 1u << 31;; bit >>= 1)
+    {
+        if (a & bit)
+        {
+            product ^= b;
+            if ((a & (bit - 1)) == 0)
+            {
+                return product;
+            }
+        }
+        b = b & 1 ? (b >> 1) ^ CRC32C_POLYNOMIAL : b >> 1;
+    }
+}
+
+// x^(8 * byteCount) modulo the polynomial: multiplying a CRC state by it is
+// the same as running byteCount zero bytes through it.
+inline uint32_t crc32cZeroBytesOperator(uint64_t byteCount)
+{
+    uint32_t power = 1u << 30; // x^1
+    uint32_t result = 1u << 31; // x^0
+
+    for (uint64_t bits = byteCount * 8; bits > 0; bits >>= 1)
+    {
+        if (bits & 1)
+        {
+            result = crc32cMultiply(power, result);
+        }
+        power = crc32cMultiply(power, power);
+    }
+
+    return result;
+}
+
+// Slicing-by-8 tables for machines without the CRC32 instruction.
+inline const std::array<std::array<uint32_t, 256>, 8>& getCrc32cTables()
+{
+    static const std::array<std::array<uint32_t, 256>, 8> tables = []()
+    {
+        std::array<std::array<uint32_t, 256>, 8> built = {};
+        for (uint32_t byte = 0; byte < 256; byte++)
+        {
+            uint32_t crc = byte;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+            }
+            built[0][byte] = crc;
+        }
+        for (uint32_t byte = 0; byte < 256; byte++)
+        {
+            for (int slice = 1; slice < 8; slice++)
+            {
+                built[slice][byte] = (built[slice - 1][byte] >> 8) ^ built[0][built[slice - 1][byte] & 0xFF];
+            }
+        }
+
+        return built;
+    }();
+
+    return tables;
+}
+
+// The CRC register update without the pre and post inversion.
+inline uint32_t crc32cTableUpdate(uint32_t crc, const uint8_t* data, size_t size)
+{
+    const std::array<std::array<uint32_t, 256>, 8>& tables = getCrc32cTables();
+
+    for (; size >= 8; data += 8, size -= 8)
+    {
+        uint32_t low;
+        uint32_t high;
+        std::memcpy(&low, data, 4);
+        std::memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24]
+            ^ tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^ tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+    }
+    for (; size > 0; data++, size--)
+    {
+        crc = (crc >> 8) ^ tables[0][(crc ^ *data) & 0xFF];
+    }
+
+    return crc;
+}
+
+#ifdef POKERPAL_CRC32C_HARDWARE
+inline bool hasCrc32cInstruction()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+// The CRC32 instruction has a latency of three cycles but issues every
+// cycle, so large buffers run as three streams over adjacent stripes whose
+// results are shifted into place and combined.
+POKERPAL_TARGET_SSE42 inline uint32_t crc32cHardwareUpdate(uint32_t crc, const uint8_t* data, size_t size)
+{
+    static const uint32_t stripeShift = crc32cZeroBytesOperator(CRC32C_STRIPE);
+
+    for (; size > 0 && reinterpret_cast<uintptr_t>(data) % 8 != 0; data++, size--)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+
+    uint64_t state = crc;
+    for (; size >= 3 * CRC32C_STRIPE; data += 3 * CRC32C_STRIPE, size -= 3 * CRC32C_STRIPE)
+    {
+        uint64_t first = state;
+        uint64_t second = 0;
+        uint64_t third = 0;
+        for (size_t offset = 0; offset < CRC32C_STRIPE; offset += 8)
+        {
+            uint64_t words[3];
+            std::memcpy(&words[0], data + offset, 8);
+            std::memcpy(&words[1], data + CRC32C_STRIPE + offset, 8);
+            std::memcpy(&words[2], data + 2 * CRC32C_STRIPE + offset, 8);
+            first = _mm_crc32_u64(first, words[0]);
+            second = _mm_crc32_u64(second, words[1]);
+            third = _mm_crc32_u64(third, words[2]);
+        }
+
+        uint32_t combined = crc32cMultiply(stripeShift, static_cast<uint32_t>(first)) ^ static_cast<uint32_t>(second);
+        state = crc32cMultiply(stripeShift, combined) ^ static_cast<uint32_t>(third);
+    }
+    for (; size >= 8; data += 8, size -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        state = _mm_crc32_u64(state, word);
+    }
+
+    crc = static_cast<uint32_t>(state);
+    for (; size > 0; data++, size--)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+
+    return crc;
+}
+#endif
+
+// CRC32C of data, continuing from the CRC of whatever came before it.
+inline uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+#ifdef POKERPAL_CRC32C_HARDWARE
+    static const bool hardware = hasCrc32cInstruction();
+    if (hardware)
+    {
+        return ~crc32cHardwareUpdate(~crc, bytes, size);
+    }
+#endif
+
+    return ~crc32cTableUpdate(~crc, bytes, size);
+}
+
+inline uint32_t crc32c(std::string_view text, uint32_t crc = 0)
+{
+    return crc32c(text.data(), text.size(), crc);
+}
+
+// Frames text for readTextBlocks: after every linesPerBlock lines comes a
+// "#crc32c <crc> <lines>" line checksumming the lines above it. The text
+// stays readable and appendable by hand. Every line must end in '\n'.
+inline std::string frameTextBlocks(std::string_view lines, size_t linesPerBlock = TEXT_BLOCK_LINES)
+{
+    std::string framed;
+    framed.reserve(lines.size() + (lines.size() / 16 / linesPerBlock + 1) * 24);
+
+    size_t blockStart = 0;
+    size_t lineCount = 0;
+    for (size_t end = lines.find('\n'); end != std::string_view::npos; end = lines.find('\n', end + 1))
+    {
+        if (++lineCount == linesPerBlock || end + 1 == lines.size())
+        {
+            std::string_view block = lines.substr(blockStart, end + 1 - blockStart);
+            char crc[9];
+            std::snprintf(crc, sizeof(crc), "%08x", crc32c(block));
+
+            framed.append(block);
+            framed.append(TEXT_BLOCK_MARKER).append(crc).append(" ").append(std::to_string(lineCount)).append("\n");
+            blockStart = end + 1;
+            lineCount = 0;
+        }
+    }
+
+    return framed;
+}
+
+struct TextBlockScan
+{
+    size_t corruptBlocks = 0;
+    size_t corruptLines = 0;
+    size_t framedBytes = 0; // up to the end of the last checksum line
+    bool tornTail = false;  // unchecksummed lines after the last checksum
+};
+
+// Reads text framed by frameTextBlocks, calling onLine(line, intact) for
+// every line in order. A block whose checksum fails comes with intact false
+// and is reported once. Lines outside any block are intact if they come
+// before the first checksum (a file from before framing); after it they are
+// a torn tail.
+template <typename LineHandler>
+TextBlockScan readTextBlocks(std::string_view text, const std::string& path, LineHandler onLine)
+{
+    TextBlockScan scan;
+    std::vector<std::pair<size_t, size_t>> pending; // lines since the last checksum
+    bool framed = false;
+
+    auto emit = [&](size_t first, size_t last, bool intact)
+    {
+        for (size_t line = first; line < last; line++)
+        {
+            std::string_view name = text.substr(pending[line].first, pending[line].second - pending[line].first);
+            if (!name.empty() && name.back() == '\r')
+            {
+                name.remove_suffix(1);
+            }
+            onLine(name, intact);
+        }
+        scan.corruptLines += intact ? 0 : last - first;
+    };
+
+    size_t begin = 0;
+    while (begin < text.size())
+    {
+        size_t end = std::min(text.find('\n', begin), text.size());
+        std::string_view line = text.substr(begin, end - begin);
+
+        if (line.rfind(TEXT_BLOCK_MARKER, 0) != 0)
+        {
+            pending.push_back({ begin, end });
+            begin = end + 1;
+            continue;
+        }
+
+        uint32_t expectedCrc = 0;
+        size_t blockLines = 0;
+        const char* fields = line.data() + TEXT_BLOCK_MARKER.size();
+        auto crcField = std::from_chars(fields, line.data() + line.size(), expectedCrc, 16);
+        auto countField = std::from_chars(crcField.ptr + (crcField.ptr < line.data() + line.size()), line.data() + line.size(), blockLines);
+        bool parsed = crcField.ec == std::errc() && countField.ec == std::errc() && blockLines <= pending.size() && blockLines > 0;
+
+        size_t firstBlockLine = parsed ? pending.size() - blockLines : 0;
+        bool intact = parsed && crc32c(text.substr(pending[firstBlockLine].first, begin - pending[firstBlockLine].first)) == expectedCrc;
+
+        emit(0, firstBlockLine, !framed);
+        emit(firstBlockLine, pending.size(), intact);
+        scan.corruptBlocks += intact ? 0 : 1;
+
+        pending.clear();
+        framed = true;
+        begin = end + 1;
+        scan.framedBytes = std::min(begin, text.size());
+    }
+
+    scan.tornTail = framed && !pending.empty();
+    emit(0, pending.size(), !scan.tornTail);
+    scan.corruptBlocks += scan.tornTail ? 1 : 0;
+
+    if (scan.corruptBlocks > 0)
+    {
+        std::cerr << "WARNING: Skipped " << scan.corruptBlocks << " corrupt block(s) (" << scan.corruptLines
+            << " lines) of '" << path << "'." << '\n';
+    }
+
+    return scan;
+}
@@ -0,0 +1,308 @@
+#pragma once
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Cards.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+constexpr int EQUITY_SAMPLES_PER_MATCHUP = 2000;
+constexpr int EQUITY_FILE_SAMPLES_PER_MATCHUP = 20000;
+
+const std::string PREFLOP_EQUITY_FILE = "preflop_equity.bin";
+const char EQUITY_FILE_MAGIC[8] = { 'P', 'P', 'E', 'Q', 'T', 'Y', '0', '1' };
+
+// Equity tables on disk are a header, one completion flag per row (so an
+// interrupted build can resume) and then the row-major float matrix, aligned
+// so it can be used in place once the file is mapped. `finished` is only set
+// once the whole matrix has been written.
+struct EquityFileHeader
+{
+    char magic[8];
+    uint32_t dimension;
+    uint32_t samplesPerMatchup;
+    uint32_t finished;
+};
+
+inline size_t equityFileDataOffset(int dimension)
+{
+    size_t headerAndFlags = sizeof(EquityFileHeader) + dimension;
+    return (headerAndFlags + 63) / 64 * 64;
+}
+
+inline size_t equityFileSize(int dimension)
+{
+    return equityFileDataOffset(dimension) + sizeof(float) * dimension * dimension;
+}
+
+// Heads-up all-in equity of every hand class against every other, row major
+// so a row is one hand's equity against all opponents. Values are either
+// owned or read straight out of a mapped equity file.
+class EquityMatrix
+{
+public:
+    explicit EquityMatrix(int dimension = NUM_HAND_CLASSES)
+        : dimension(dimension), ownedValues(size_t(dimension) * dimension, 0.5f), values(ownedValues.data())
+    {
+    }
+
+    EquityMatrix(const EquityMatrix&) = delete;
+    EquityMatrix& operator=(const EquityMatrix&) = delete;
+    EquityMatrix(EquityMatrix&&) = default;
+    EquityMatrix& operator=(EquityMatrix&&) = default;
+
+    // Maps a completed equity file, keeping the current values if the file
+    // is missing, unfinished or holds a different table.
+    bool loadFile(const std::string& path)
+    {
+        MappedFile file;
+        if (!file.open(path) || file.size() < sizeof(EquityFileHeader))
+        {
+            return false;
+        }
+
+        EquityFileHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        if (std::memcmp(header.magic, EQUITY_FILE_MAGIC, sizeof(header.magic)) != 0
+            || header.dimension != static_cast<uint32_t>(NUM_HAND_CLASSES)
+            || header.finished == 0 || file.size() != equityFileSize(header.dimension))
+        {
+            return false;
+        }
+
+        dimension = static_cast<int>(header.dimension);
+        values = reinterpret_cast<const float*>(file.data() + equityFileDataOffset(dimension));
+        mappedFile = std::move(file);
+        ownedValues.clear();
+        ownedValues.shrink_to_fit();
+
+        return true;
+    }
+
+    int size() const { return dimension; }
+    float at(int hero, int villain) const { return values[size_t(hero) * dimension + villain]; }
+    const float* row(int hero) const { return &values[size_t(hero) * dimension]; }
+    float* mutableRow(int hero) { return &ownedValues[size_t(hero) * dimension]; }
+
+private:
+    int dimension;
+    std::vector<float> ownedValues;
+    MappedFile mappedFile;
+    const float* values;
+};
+
+inline float showdownShare(uint64_t heroCards, uint64_t villainCards, FastRng& rng)
+{
+    uint64_t usedCards = heroCards | villainCards;
+    uint64_t board = 0;
+    for (int card = 0; card < 5; card++)
+    {
+        board |= cardMask(drawCard(rng, usedCards));
+    }
+
+    uint32_t heroScore = evaluateHand(heroCards | board);
+    uint32_t villainScore = evaluateHand(villainCards | board);
+
+    return heroScore > villainScore ? 1.0f : (heroScore == villainScore ? 0.5f : 0.0f);
+}
+
+// Plays random combos of both classes to the river and returns the first
+// class's share of the pot (ties count as half).
+inline float sampleMatchupEquity(int heroClass, int villainClass, int samples, FastRng& rng)
+{
+    const HandClassCombos& classCombos = getHandClassCombos();
+    double heroShare = 0.0;
+
+    for (int i = 0; i < samples; i++)
+    {
+        const HoleCards& hero = classCombos.combos[heroClass][rng.bounded(classCombos.counts[heroClass])];
+        const HoleCards& villain = classCombos.combos[villainClass][rng.bounded(classCombos.counts[villainClass])];
+
+        uint64_t heroCards = cardMask(hero.first) | cardMask(hero.second);
+        uint64_t villainCards = cardMask(villain.first) | cardMask(villain.second);
+
+        if (heroCards & villainCards)
+        {
+            i--; // combos collide, draw again
+            continue;
+        }
+
+        heroShare += showdownShare(heroCards, villainCards, rng);
+    }
+
+    return static_cast<float>(heroShare / samples);
+}
+
+// Estimates the class matrix in memory, one hero row per work item. Only used
+// when the equity file cannot be written.
+inline EquityMatrix computeEquityMatrix(int samplesPerMatchup)
+{
+    EquityMatrix matrix(NUM_HAND_CLASSES);
+
+    parallelFor(NUM_HAND_CLASSES, [&](size_t hero)
+    {
+        FastRng rng(hero + 1);
+
+        for (int villain = static_cast<int>(hero) + 1; villain < NUM_HAND_CLASSES; villain++)
+        {
+            float equity = sampleMatchupEquity(static_cast<int>(hero), villain, samplesPerMatchup, rng);
+            matrix.mutableRow(static_cast<int>(hero))[villain] = equity;
+            matrix.mutableRow(villain)[hero] = 1.0f - equity;
+        }
+    });
+
+    return matrix;
+}
+
+// Builds (or finishes building) the class equity file. Rows are computed in
+// parallel and each one is flagged complete as soon as its cells right of the
+// diagonal are written, so an interrupted run picks up where it stopped. Once
+// every row is done the lower triangle is mirrored in one pass and the file is
+// marked finished.
+inline bool generateEquityFile(const std::string& path, int samplesPerMatchup)
+{
+    const int dimension = NUM_HAND_CLASSES;
+    const size_t dataOffset = equityFileDataOffset(dimension);
+    std::vector<char> rowComplete(dimension, 0);
+
+    EquityFileHeader header;
+    std::memcpy(header.magic, EQUITY_FILE_MAGIC, sizeof(header.magic));
+    header.dimension = dimension;
+    header.samplesPerMatchup = samplesPerMatchup;
+    header.finished = 0;
+
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    EquityFileHeader existingHeader;
+
+    bool resuming = file.is_open()
+        && file.read(reinterpret_cast<char*>(&existingHeader), sizeof(existingHeader))
+        && std::memcmp(existingHeader.magic, header.magic, sizeof(header.magic)) == 0
+        && existingHeader.dimension == header.dimension
+        && existingHeader.samplesPerMatchup == header.samplesPerMatchup
+        && file.read(rowComplete.data(), dimension);
+
+    if (resuming && existingHeader.finished != 0)
+    {
+        return true;
+    }
+
+    if (!resuming)
+    {
+        file.close();
+        file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+        {
+            std::cerr << "ERROR: Unable to write '" << path << "'!" << '\n';
+            return false;
+        }
+
+        std::vector<char> emptyFile(equityFileSize(dimension), 0);
+        std::memcpy(emptyFile.data(), &header, sizeof(header));
+        file.write(emptyFile.data(), emptyFile.size());
+        file.flush();
+    }
+
+    std::vector<int> pendingRows;
+    for (int row = 0; row < dimension; row++)
+    {
+        if (rowComplete[row] == 0)
+        {
+            pendingRows.push_back(row);
+        }
+    }
+
+    if (resuming)
+    {
+        std::cout << "Resuming '" << path << "' with " << pendingRows.size() << " of " << dimension
+            << " rows left..." << '\n';
+    }
+
+    std::mutex fileMutex;
+    int rowsWritten = dimension - static_cast<int>(pendingRows.size());
+
+    parallelFor(pendingRows.size(), [&](size_t pendingIndex)
+    {
+        const int hero = pendingRows[pendingIndex];
+        FastRng rng(hero + 1);
+        std::vector<float> equities(dimension, 0.0f);
+
+        for (int villain = hero + 1; villain < dimension; villain++)
+        {
+            equities[villain] = sampleMatchupEquity(hero, villain, samplesPerMatchup, rng);
+        }
+
+        std::lock_guard<std::mutex> lock(fileMutex);
+
+        file.seekp(dataOffset + sizeof(float) * (size_t(hero) * dimension + hero + 1));
+        file.write(reinterpret_cast<const char*>(&equities[hero + 1]), sizeof(float) * (dimension - hero - 1));
+        file.flush();
+
+        // Flag the row only once its values are on disk.
+        char complete = 1;
+        file.seekp(sizeof(EquityFileHeader) + hero);
+        file.write(&complete, 1);
+        file.flush();
+
+        rowsWritten++;
+        if (rowsWritten % 16 == 0 || rowsWritten == dimension)
+        {
+            std::cout << "  " << rowsWritten << "/" << dimension << " rows" << '\n';
+        }
+    });
+
+    std::vector<float> values(size_t(dimension) * dimension);
+    file.seekg(dataOffset);
+    file.read(reinterpret_cast<char*>(values.data()), sizeof(float) * values.size());
+
+    for (int hero = 0; hero < dimension; hero++)
+    {
+        values[size_t(hero) * dimension + hero] = 0.5f;
+
+        for (int villain = hero + 1; villain < dimension; villain++)
+        {
+            values[size_t(villain) * dimension + hero] = 1.0f - values[size_t(hero) * dimension + villain];
+        }
+    }
+
+    file.seekp(dataOffset);
+    file.write(reinterpret_cast<const char*>(values.data()), sizeof(float) * values.size());
+    file.flush();
+
+    header.finished = 1;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.flush();
+
+    return file.good();
+}
+
+inline const EquityMatrix& getPreflopEquityMatrix()
+{
+    static const EquityMatrix matrix = []()
+    {
+        EquityMatrix equity(NUM_HAND_CLASSES);
+
+        if (equity.loadFile(PREFLOP_EQUITY_FILE))
+        {
+            return equity;
+        }
+
+        std::cout << "Generating '" << PREFLOP_EQUITY_FILE << "' (first run only)..." << '\n';
+        if (generateEquityFile(PREFLOP_EQUITY_FILE, EQUITY_FILE_SAMPLES_PER_MATCHUP)
+            && equity.loadFile(PREFLOP_EQUITY_FILE))
+        {
+            return equity;
+        }
+
+        std::cerr << "WARNING: Using a lower precision equity matrix computed in memory." << '\n';
+        return computeEquityMatrix(EQUITY_SAMPLES_PER_MATCHUP);
+    }();
+
+    return matrix;
+}
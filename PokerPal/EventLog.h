@@ -0,0 +1,328 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+constexpr size_t EVENT_RING_RECORDS = 4096;   // per thread, a power of two
+constexpr size_t EVENT_ARGUMENT_BYTES = 116; // keeps an EventRecord at 128 bytes
+constexpr size_t EVENT_ARGUMENT_LIMIT = 4;
+
+// Every message the event log can write. The arguments each one takes are
+// noted beside it and filled into its "{}"s in order.
+enum EventId : uint16_t
+{
+    EVENT_PLAYER_NOT_FOUND,       // name, suggestions
+    EVENT_PLAYER_NOT_FOUND_RETRY, // suggestions
+    EVENT_NAME_TAKEN,
+    EVENT_PLAYER_LIST_MISSING,
+    EVENT_MUST_KEEP_ONE_PLAYER,
+    EVENT_HISTORY_UNREADABLE,     // path
+    EVENT_NO_POT_SET,
+    EVENT_WINNINGS_EXCEED_POT,    // dollars
+    EVENT_WINNINGS_BELOW_POT,     // dollars
+    EVENT_INVALID_MENU_OPTION,
+    EVENT_INVALID_CHIP_AMOUNT,
+    EVENT_INVALID_PLACES,
+    EVENT_INVALID_HANDS,
+    EVENT_INVALID_PLAYER_COUNT,
+    EVENT_INVALID_POT_AMOUNT,
+    EVENT_INVALID_BLIND_AMOUNT,
+    EVENT_INVALID_PAYOUT_AMOUNT,
+    EVENT_COUNT
+};
+
+const char* const EVENT_FORMATS[EVENT_COUNT] = {
+    "ERROR: Player '{}' not found!{}\n",
+    "ERROR: Player not found!{} Please enter a valid name: ",
+    "ERROR: Name is not allowed or taken! Please enter a different name: ",
+    "ERROR: Missing 'players.txt' file!\n",
+    "ERROR: Must be at least one player!\n",
+    "ERROR: Unable to read hand history '{}'!\n",
+    "WARNING: No pot amount is currently set.\n",
+    "WARNING: Total winnings exceed the pot amount by ${}! Ensure chips haven't been overcounted.\n",
+    "WARNING: Total winnings are less than the pot amount by ${}! Ensure chips haven't been undercounted.\n",
+    "ERROR: Please enter a valid menu option: ",
+    "ERROR: Invalid amount! Enter a valid number of chips: ",
+    "ERROR: Please enter a valid number of places: ",
+    "ERROR: Please enter a valid number of hands: ",
+    "ERROR: Please enter a valid number of players: ",
+    "ERROR: Please enter a valid pot amount: ",
+    "ERROR: Please enter a valid blind amount: ",
+    "ERROR: Please enter a valid payout amount: ",
+};
+
+enum EventArgumentType : uint8_t { EVENT_TEXT, EVENT_INTEGER, EVENT_DOLLARS };
+
+// One event as logged: its id and its arguments packed as raw bytes. Text
+// is stored as a length and the bytes, cut short if the record is full.
+struct EventRecord
+{
+    uint16_t id;
+    uint8_t argumentCount;
+    uint8_t types[EVENT_ARGUMENT_LIMIT];
+    uint8_t unused;
+    uint16_t size;
+    char arguments[EVENT_ARGUMENT_BYTES];
+};
+
+// Written by its own thread and read by the formatter. Rings outlive their
+// threads so nothing logged is lost when a worker finishes.
+struct EventRing
+{
+    std::unique_ptr<EventRecord[]> records = std::make_unique<EventRecord[]>(EVENT_RING_RECORDS);
+    std::atomic<uint64_t> written{ 0 };
+    std::atomic<uint64_t> read{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+    EventRing* next = nullptr;
+};
+
+// Errors and warnings from lookups, reconciliation and input checks are
+// logged as an EventId and raw arguments into the calling thread's ring; a
+// background thread formats them and writes them to standard error. Logging
+// never waits: when a ring is full the event is dropped and counted. The
+// formatter is woken once per burst rather than once per event.
+class EventLog
+{
+public:
+    EventLog()
+        : formatter([this]() { run(); })
+    {
+    }
+
+    ~EventLog()
+    {
+        stopping = true;
+        wake();
+        formatter.join();
+        drain();
+    }
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    void submit(const EventRecord& record)
+    {
+        EventRing& ring = threadRing();
+        uint64_t written = ring.written.load(std::memory_order_relaxed);
+        if (written - ring.read.load(std::memory_order_acquire) == EVENT_RING_RECORDS)
+        {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        ring.records[written & (EVENT_RING_RECORDS - 1)] = record;
+        ring.written.store(written + 1, std::memory_order_release);
+        if (!pending.exchange(true))
+        {
+            pending.notify_one();
+        }
+    }
+
+    // Waits until everything logged so far has been written, so it comes
+    // before whatever the caller prints next.
+    void flush()
+    {
+        for (EventRing* ring = rings.load(); ring != nullptr; ring = ring->next)
+        {
+            uint64_t target = ring->written.load(std::memory_order_acquire);
+            while (ring->read.load(std::memory_order_acquire) < target)
+            {
+                uint64_t generation = drained.load();
+                wake();
+                if (ring->read.load(std::memory_order_acquire) < target)
+                {
+                    drained.wait(generation);
+                }
+            }
+        }
+    }
+
+private:
+    EventRing& threadRing()
+    {
+        thread_local EventRing* ring = nullptr;
+        if (ring == nullptr)
+        {
+            ring = new EventRing();
+            ring->next = rings.load();
+            while (!rings.compare_exchange_weak(ring->next, ring))
+            {
+            }
+        }
+
+        return *ring;
+    }
+
+    void wake()
+    {
+        pending.store(true);
+        pending.notify_one();
+    }
+
+    void run()
+    {
+        while (!stopping)
+        {
+            pending.wait(false);
+            pending.store(false);
+            drain();
+        }
+    }
+
+    void drain()
+    {
+        std::string text;
+        uint64_t dropped = 0;
+
+        for (EventRing* ring = rings.load(); ring != nullptr; ring = ring->next)
+        {
+            uint64_t written = ring->written.load(std::memory_order_acquire);
+            for (uint64_t i = ring->read.load(std::memory_order_relaxed); i < written; i++)
+            {
+                format(ring->records[i & (EVENT_RING_RECORDS - 1)], text);
+            }
+            ring->read.store(written, std::memory_order_release);
+            dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+        }
+
+        if (dropped > 0)
+        {
+            text += "WARNING: Dropped " + std::to_string(dropped) + " log event(s) while the log was full.\n";
+        }
+        if (!text.empty())
+        {
+            std::cerr.write(text.data(), text.size());
+            std::cerr.flush();
+        }
+
+        drained.fetch_add(1);
+        drained.notify_all();
+    }
+
+    static void format(const EventRecord& record, std::string& text)
+    {
+        std::string_view pattern = record.id < EVENT_COUNT ? EVENT_FORMATS[record.id] : "ERROR: Unknown event {}\n";
+        const char* argument = record.arguments;
+
+        for (int i = 0; i < record.argumentCount || !pattern.empty(); i++)
+        {
+            size_t hole = pattern.find("{}");
+            text.append(pattern.substr(0, hole));
+            pattern.remove_prefix(hole == std::string_view::npos ? pattern.size() : hole + 2);
+            if (hole == std::string_view::npos || i >= record.argumentCount)
+            {
+                continue;
+            }
+
+            if (record.types[i] == EVENT_TEXT)
+            {
+                uint16_t length;
+                std::memcpy(&length, argument, sizeof(length));
+                text.append(argument + sizeof(length), length);
+                argument += sizeof(length) + length;
+            }
+            else
+            {
+                int64_t value;
+                std::memcpy(&value, argument, sizeof(value));
+                argument += sizeof(value);
+
+                char digits[32];
+                int length = record.types[i] == EVENT_DOLLARS
+                    ? std::snprintf(digits, sizeof(digits), "%.2f", value / 100.0)
+                    : std::snprintf(digits, sizeof(digits), "%lld", static_cast<long long>(value));
+                text.append(digits, length);
+            }
+        }
+    }
+
+    std::atomic<EventRing*> rings{ nullptr };
+    std::atomic<bool> pending{ false };
+    std::atomic<uint64_t> drained{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::thread formatter;
+};
+
+inline EventLog& getEventLog()
+{
+    static EventLog log;
+    return log;
+}
+
+// A dollar amount, logged as whole cents.
+struct EventDollars
+{
+    long long cents;
+};
+
+inline void packEventArgument(EventRecord& record, std::string_view text)
+{
+    if (EVENT_ARGUMENT_BYTES - record.size < sizeof(uint16_t))
+    {
+        return;
+    }
+
+    uint16_t length = static_cast<uint16_t>(std::min(text.size(), EVENT_ARGUMENT_BYTES - record.size - sizeof(uint16_t)));
+    std::memcpy(record.arguments + record.size, &length, sizeof(length));
+    std::memcpy(record.arguments + record.size + sizeof(length), text.data(), length);
+    record.types[record.argumentCount++] = EVENT_TEXT;
+    record.size += static_cast<uint16_t>(sizeof(length) + length);
+}
+
+inline void packEventArgument(EventRecord& record, int64_t value, EventArgumentType type)
+{
+    if (EVENT_ARGUMENT_BYTES - record.size < sizeof(value))
+    {
+        return;
+    }
+
+    std::memcpy(record.arguments + record.size, &value, sizeof(value));
+    record.types[record.argumentCount++] = type;
+    record.size += static_cast<uint16_t>(sizeof(value));
+}
+
+// Logs an event with its arguments: text, integers or EventDollars. Long
+// text is cut short, and an argument that no longer fits is left blank.
+template <typename... Arguments>
+void logEvent(EventId id, const Arguments&... arguments)
+{
+    static_assert(sizeof...(Arguments) <= EVENT_ARGUMENT_LIMIT, "too many event arguments");
+
+    EventRecord record;
+    record.id = id;
+    record.argumentCount = 0;
+    record.size = 0;
+
+    [[maybe_unused]] auto pack = [&](const auto& argument)
+    {
+        using Argument = std::decay_t<decltype(argument)>;
+        if constexpr (std::is_same_v<Argument, EventDollars>)
+        {
+            packEventArgument(record, argument.cents, EVENT_DOLLARS);
+        }
+        else if constexpr (std::is_integral_v<Argument>)
+        {
+            packEventArgument(record, static_cast<int64_t>(argument), EVENT_INTEGER);
+        }
+        else
+        {
+            packEventArgument(record, std::string_view(argument));
+        }
+    };
+    (pack(arguments), ...);
+
+    getEventLog().submit(record);
+}
+
+inline void flushEventLog()
+{
+    getEventLog().flush();
+}
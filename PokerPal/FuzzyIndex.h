@@ -0,0 +1,291 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <climits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+constexpr int MAX_SUGGESTION_DISTANCE = 2;
+constexpr size_t MAX_NAME_SUGGESTIONS = 3;
+constexpr size_t SUGGESTION_PREFIX_LENGTH = 6;
+
+// Levenshtein distance from one pattern to many texts. Patterns of up to 64
+// characters use Myers' bit-parallel algorithm (one machine word per text
+// character); longer ones fall back to the row-by-row table.
+class LevenshteinPattern
+{
+public:
+    explicit LevenshteinPattern(std::string_view pattern)
+        : pattern(pattern)
+    {
+        if (pattern.size() <= 64)
+        {
+            for (size_t i = 0; i < pattern.size(); i++)
+            {
+                matchMasks[static_cast<unsigned char>(pattern[i])] |= 1ULL << i;
+            }
+        }
+    }
+
+    int distance(std::string_view text) const
+    {
+        if (pattern.empty() || pattern.size() > 64)
+        {
+            return tableDistance(text);
+        }
+
+        uint64_t positiveVertical = ~0ULL;
+        uint64_t negativeVertical = 0;
+        uint64_t lastRow = 1ULL << (pattern.size() - 1);
+        int score = static_cast<int>(pattern.size());
+
+        for (char c : text)
+        {
+            uint64_t equal = matchMasks[static_cast<unsigned char>(c)];
+            uint64_t verticalChange = equal | negativeVertical;
+            uint64_t horizontalChange = (((equal & positiveVertical) + positiveVertical) ^ positiveVertical) | equal;
+            uint64_t positiveHorizontal = negativeVertical | ~(horizontalChange | positiveVertical);
+            uint64_t negativeHorizontal = positiveVertical & horizontalChange;
+
+            score += (positiveHorizontal & lastRow) ? 1 : (negativeHorizontal & lastRow) ? -1 : 0;
+
+            // The top row of the table counts text characters, so it always steps by +1.
+            positiveHorizontal = (positiveHorizontal << 1) | 1;
+            negativeHorizontal <<= 1;
+            positiveVertical = negativeHorizontal | ~(verticalChange | positiveHorizontal);
+            negativeVertical = positiveHorizontal & verticalChange;
+        }
+
+        return score;
+    }
+
+private:
+    int tableDistance(std::string_view text) const
+    {
+        std::vector<int> row(text.size() + 1);
+        for (size_t j = 0; j <= text.size(); j++)
+        {
+            row[j] = static_cast<int>(j);
+        }
+
+        for (size_t i = 1; i <= pattern.size(); i++)
+        {
+            int diagonal = row[0];
+            row[0] = static_cast<int>(i);
+
+            for (size_t j = 1; j <= text.size(); j++)
+            {
+                int above = row[j];
+                row[j] = std::min({ row[j] + 1, row[j - 1] + 1, diagonal + (pattern[i - 1] == text[j - 1] ? 0 : 1) });
+                diagonal = above;
+            }
+        }
+
+        return row[text.size()];
+    }
+
+    std::string_view pattern;
+    std::array<uint64_t, 256> matchMasks{};
+};
+
+// SymSpell index over player names. Every name is filed under each string
+// left by deleting up to MAX_SUGGESTION_DISTANCE characters from its first
+// SUGGESTION_PREFIX_LENGTH characters. Two names within that distance share
+// at least one such delete, so a lookup generates the query's deletes, probes
+// the table and only verifies the few names it finds. The table is keyed by
+// a 32-bit hash of each delete; hash collisions only add candidates that
+// verification then rejects. Removed names are skipped until
+// the same name is added again.
+class FuzzyNameIndex
+{
+public:
+    size_t size() const { return liveCount; }
+
+    void insert(const std::string& name)
+    {
+        auto existing = nameIds.find(name);
+        if (existing != nameIds.end())
+        {
+            liveCount += removed[existing->second] ? 1 : 0;
+            removed[existing->second] = false;
+            return;
+        }
+
+        uint32_t id = static_cast<uint32_t>(names.size());
+        names.push_back(name);
+        removed.push_back(false);
+        nameIds[name] = id;
+        liveCount++;
+
+        forEachDeleteHash(name, [&](uint32_t hash)
+        {
+            addEntry(hash, id);
+        });
+    }
+
+    void erase(const std::string& name)
+    {
+        auto existing = nameIds.find(name);
+        if (existing != nameIds.end() && !removed[existing->second])
+        {
+            removed[existing->second] = true;
+            liveCount--;
+        }
+    }
+
+    // The closest names within maxDistance (at most MAX_SUGGESTION_DISTANCE),
+    // nearest first.
+    std::vector<std::string> closest(std::string_view query, int maxDistance, size_t limit) const
+    {
+        std::vector<uint32_t> candidates;
+        if (buckets.empty())
+        {
+            return {};
+        }
+
+        forEachDeleteHash(query, [&](uint32_t hash)
+        {
+            size_t slot = findBucket(hash);
+            for (uint32_t posting = buckets[slot].head; posting != NO_POSTING; posting = postings[posting].next)
+            {
+                candidates.push_back(postings[posting].id);
+            }
+        });
+
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        LevenshteinPattern pattern(query);
+        std::vector<std::pair<int, uint32_t>> matches;
+
+        for (uint32_t id : candidates)
+        {
+            int distance = removed[id] ? maxDistance + 1 : pattern.distance(names[id]);
+            if (distance <= maxDistance)
+            {
+                matches.push_back({ distance, id });
+            }
+        }
+
+        std::sort(matches.begin(), matches.end(), [&](const std::pair<int, uint32_t>& a, const std::pair<int, uint32_t>& b)
+        {
+            return a.first < b.first || (a.first == b.first && names[a.second] < names[b.second]);
+        });
+
+        std::vector<std::string> closestNames;
+        for (size_t i = 0; i < matches.size() && i < limit; i++)
+        {
+            closestNames.push_back(names[matches[i].second]);
+        }
+
+        return closestNames;
+    }
+
+private:
+    static constexpr uint32_t NO_POSTING = UINT32_MAX;
+
+    // One bucket per distinct delete hash, heading a linked list of postings.
+    struct Bucket
+    {
+        uint32_t hash;
+        uint32_t head;
+    };
+
+    struct Posting
+    {
+        uint32_t id;
+        uint32_t next;
+    };
+
+    // Calls visit(hash) once for every distinct delete of the word's prefix.
+    // Positions first < second are deleted, where -1 and length stand for no
+    // deletion, which covers the prefix itself and every one or two deletes.
+    template <typename Visitor>
+    static void forEachDeleteHash(std::string_view word, Visitor&& visit)
+    {
+        static_assert(MAX_SUGGESTION_DISTANCE == 2, "deletes are enumerated as position pairs");
+
+        std::string_view prefix = word.substr(0, SUGGESTION_PREFIX_LENGTH);
+        int length = static_cast<int>(prefix.size());
+        std::array<uint32_t, 1 + SUGGESTION_PREFIX_LENGTH * (SUGGESTION_PREFIX_LENGTH + 1) / 2> hashes;
+        size_t hashCount = 0;
+
+        for (int first = -1; first < length; first++)
+        {
+            for (int second = first < 0 ? length : first + 1; second <= length; second++)
+            {
+                uint32_t hash = 2166136261u; // FNV-1a
+                for (int c = 0; c < length; c++)
+                {
+                    if (c != first && c != second)
+                    {
+                        hash = (hash ^ static_cast<unsigned char>(prefix[c])) * 16777619u;
+                    }
+                }
+
+                hashes[hashCount++] = hash;
+            }
+        }
+
+        std::sort(hashes.begin(), hashes.begin() + hashCount);
+        for (size_t h = 0; h < hashCount; h++)
+        {
+            if (h == 0 || hashes[h] != hashes[h - 1])
+            {
+                visit(hashes[h]);
+            }
+        }
+    }
+
+    // Open addressing over buckets.size(), a power of two. Returns the slot
+    // holding hash, or the empty slot where it would go.
+    size_t findBucket(uint32_t hash) const
+    {
+        size_t slot = hash & (buckets.size() - 1);
+        while (buckets[slot].head != NO_POSTING && buckets[slot].hash != hash)
+        {
+            slot = (slot + 1) & (buckets.size() - 1);
+        }
+
+        return slot;
+    }
+
+    void addEntry(uint32_t hash, uint32_t id)
+    {
+        if ((bucketCount + 1) * 10 > buckets.size() * 7)
+        {
+            std::vector<Bucket> oldBuckets = std::move(buckets);
+            buckets.assign(std::max<size_t>(1024, oldBuckets.size() * 2), { 0, NO_POSTING });
+
+            for (const Bucket& bucket : oldBuckets)
+            {
+                if (bucket.head != NO_POSTING)
+                {
+                    buckets[findBucket(bucket.hash)] = bucket;
+                }
+            }
+        }
+
+        size_t slot = findBucket(hash);
+        if (buckets[slot].head == NO_POSTING)
+        {
+            buckets[slot].hash = hash;
+            bucketCount++;
+        }
+
+        postings.push_back({ id, buckets[slot].head });
+        buckets[slot].head = static_cast<uint32_t>(postings.size() - 1);
+    }
+
+    std::vector<std::string> names;
+    std::vector<bool> removed;
+    std::unordered_map<std::string, uint32_t> nameIds;
+    std::vector<Bucket> buckets;
+    std::vector<Posting> postings;
+    size_t bucketCount = 0;
+    size_t liveCount = 0;
+};
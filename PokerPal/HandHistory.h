@@ -0,0 +1,621 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POKERPAL_SSE2 1
+#endif
+
+#include "Cards.h"
+#include "EventLog.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "PokerPal.h"
+
+// Hand histories exported by the online tables are plain text, one hand per
+// block, with amounts in dollars:
+//
+//   Hand #1001 2024-03-25 21:14:03
+//   Seat 1: alice 10.25
+//   Seat 2: bob 8.50
+//   alice posts 0.05
+//   bob posts 0.10
+//   Dealt alice Ah Kd
+//   alice raises 0.25
+//   bob calls 0.20
+//   Board Qh 7c 2d
+//   bob checks
+//   alice checks
+//   Board 9s
+//   bob checks
+//   alice bets 0.30
+//   bob folds
+//   alice collects 1.20
+//
+// Each Board line lists only the cards dealt on that street. Every amount is the number of chips moved by that action (a raise lists
+// what was added, not the new total), so a player's net for the hand is what
+// they collected minus everything they put in.
+
+constexpr int MAX_HISTORY_SEATS = 10;
+
+// Named after the verbs used in the text export.
+enum HandActionType : uint8_t { POSTS, FOLDS, CHECKS, CALLS, BETS, RAISES, COLLECTS, SHOWS };
+
+struct HandAction
+{
+    uint8_t seat;
+    HandActionType type;
+    long long cents;
+};
+
+// One parsed hand. Names point into the mapped file, and the action vector is
+// reused from hand to hand.
+struct ParsedHand
+{
+    uint64_t handNumber = 0;
+    uint32_t date = 0;    // yyyymmdd
+    uint32_t seconds = 0; // seconds since midnight
+    int seatCount = 0;
+    std::array<std::string_view, MAX_HISTORY_SEATS> seatNames{};
+    std::array<long long, MAX_HISTORY_SEATS> startingStacks{};
+    std::array<std::array<int8_t, 2>, MAX_HISTORY_SEATS> holeCards{};
+    std::array<int8_t, 5> board{};
+    std::array<uint16_t, 5> boardActionIndex{}; // actions recorded before each board card
+    int boardCount = 0;
+    std::vector<HandAction> actions;
+
+    void clear()
+    {
+        handNumber = 0;
+        date = 0;
+        seconds = 0;
+        seatCount = 0;
+        boardCount = 0;
+        actions.clear();
+
+        for (std::array<int8_t, 2>& cards : holeCards)
+        {
+            cards = { -1, -1 };
+        }
+    }
+
+    // Net result of every seat for this hand, in cents.
+    std::array<long long, MAX_HISTORY_SEATS> netResults() const
+    {
+        std::array<long long, MAX_HISTORY_SEATS> net{};
+        for (const HandAction& action : actions)
+        {
+            if (action.type == COLLECTS)
+            {
+                net[action.seat] += action.cents;
+            }
+            else
+            {
+                net[action.seat] -= action.cents;
+            }
+        }
+
+        return net;
+    }
+};
+
+// Returns the first occurrence of `byte` in [begin, end), or end. Scans 16
+// bytes per step where SSE2 is available.
+inline const char* findByte(const char* begin, const char* end, char byte)
+{
+#ifdef POKERPAL_SSE2
+    const __m128i target = _mm_set1_epi8(byte);
+
+    while (end - begin >= 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        int matches = _mm_movemask_epi8(_mm_cmpeq_epi8(block, target));
+
+        if (matches != 0)
+        {
+            return begin + std::countr_zero(static_cast<unsigned>(matches));
+        }
+
+        begin += 16;
+    }
+#endif
+
+    const void* match = std::memchr(begin, byte, end - begin);
+    return match == nullptr ? end : static_cast<const char*>(match);
+}
+
+// Splits off the next space-separated token of a line.
+inline std::string_view nextToken(std::string_view& line)
+{
+    size_t start = line.find_first_not_of(' ');
+    if (start == std::string_view::npos)
+    {
+        line = {};
+        return {};
+    }
+
+    size_t stop = line.find(' ', start);
+    std::string_view token = line.substr(start, stop == std::string_view::npos ? std::string_view::npos : stop - start);
+    line = stop == std::string_view::npos ? std::string_view() : line.substr(stop + 1);
+
+    return token;
+}
+
+// Parses "12", "12.5", "12.50", ".50" or "-1.50" dollars into cents without
+// going through a float. The sign applies to the cents as well.
+inline bool parseCents(std::string_view text, long long& cents)
+{
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    bool negative = begin != end && *begin == '-';
+    begin += negative ? 1 : 0;
+
+    long long dollars = 0;
+    const char* point = begin;
+    if (begin == end || *begin != '.')
+    {
+        std::from_chars_result result = std::from_chars(begin, end, dollars);
+        if (result.ec != std::errc() || dollars < 0)
+        {
+            return false;
+        }
+
+        point = result.ptr;
+    }
+
+    long long fraction = 0;
+    if (point != end && *point == '.')
+    {
+        const char* digits = point + 1;
+        int digitCount = static_cast<int>(std::min<ptrdiff_t>(end - digits, 2));
+
+        if ((digitCount == 0 && point == begin)
+            || (digitCount > 0 && (std::from_chars(digits, digits + digitCount, fraction).ec != std::errc() || fraction < 0)))
+        {
+            return false;
+        }
+
+        fraction *= digitCount == 1 ? 10 : 1;
+    }
+
+    cents = (dollars * 100 + fraction) * (negative ? -1 : 1);
+    return true;
+}
+
+inline uint32_t parseDigits(std::string_view text)
+{
+    uint32_t value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+inline bool parseHandHeader(std::string_view line, ParsedHand& hand)
+{
+    nextToken(line); // "Hand"
+    std::string_view number = nextToken(line);
+    std::string_view date = nextToken(line);
+    std::string_view time = nextToken(line);
+
+    if (number.size() < 2 || number[0] != '#')
+    {
+        return false;
+    }
+
+    std::from_chars(number.data() + 1, number.data() + number.size(), hand.handNumber);
+
+    if (date.size() == 10)
+    {
+        hand.date = parseDigits(date.substr(0, 4)) * 10000 + parseDigits(date.substr(5, 2)) * 100
+            + parseDigits(date.substr(8, 2));
+    }
+    if (time.size() == 8)
+    {
+        hand.seconds = parseDigits(time.substr(0, 2)) * 3600 + parseDigits(time.substr(3, 2)) * 60
+            + parseDigits(time.substr(6, 2));
+    }
+
+    return true;
+}
+
+inline int findSeat(const ParsedHand& hand, std::string_view name)
+{
+    for (int seat = 0; seat < hand.seatCount; seat++)
+    {
+        if (hand.seatNames[seat] == name)
+        {
+            return seat;
+        }
+    }
+
+    return -1;
+}
+
+// Applies one non-header line to the hand. Unknown lines are ignored so new
+// export fields do not break older builds.
+inline void parseHandLine(std::string_view line, ParsedHand& hand)
+{
+    std::string_view first = nextToken(line);
+
+    if (first == "Seat")
+    {
+        nextToken(line); // "1:"
+        std::string_view name = nextToken(line);
+        long long stack = 0;
+        parseCents(nextToken(line), stack);
+
+        if (hand.seatCount < MAX_HISTORY_SEATS && !name.empty())
+        {
+            hand.seatNames[hand.seatCount] = name;
+            hand.startingStacks[hand.seatCount] = stack;
+            hand.seatCount++;
+        }
+    }
+    else if (first == "Board")
+    {
+        for (std::string_view card = nextToken(line); !card.empty() && hand.boardCount < 5; card = nextToken(line))
+        {
+            int boardCard = card.size() == 2 ? parseCard(card.data()) : -1;
+            if (boardCard >= 0)
+            {
+                hand.boardActionIndex[hand.boardCount] = static_cast<uint16_t>(hand.actions.size());
+                hand.board[hand.boardCount++] = static_cast<int8_t>(boardCard);
+            }
+        }
+    }
+    else if (first == "Dealt")
+    {
+        int seat = findSeat(hand, nextToken(line));
+        std::string_view card1 = nextToken(line);
+        std::string_view card2 = nextToken(line);
+
+        int firstCard = card1.size() == 2 ? parseCard(card1.data()) : -1;
+        int secondCard = card2.size() == 2 ? parseCard(card2.data()) : -1;
+
+        if (seat >= 0 && firstCard >= 0 && secondCard >= 0)
+        {
+            hand.holeCards[seat] = { static_cast<int8_t>(firstCard), static_cast<int8_t>(secondCard) };
+        }
+    }
+    else
+    {
+        int seat = findSeat(hand, first);
+        std::string_view verb = nextToken(line);
+        long long cents = 0;
+        parseCents(nextToken(line), cents);
+
+        if (seat < 0 || verb.empty())
+        {
+            return;
+        }
+
+        HandActionType type;
+        switch (verb[0])
+        {
+        case 'p': type = POSTS; break;
+        case 'f': type = FOLDS; break;
+        case 'b': type = BETS; break;
+        case 'r': type = RAISES; break;
+        case 's': type = SHOWS; break;
+        case 'c':
+            type = verb == "checks" ? CHECKS : (verb == "calls" ? CALLS : COLLECTS);
+            break;
+        default:
+            return;
+        }
+
+        hand.actions.push_back({ static_cast<uint8_t>(seat), type, cents });
+    }
+}
+
+inline bool startsWith(std::string_view text, std::string_view prefix)
+{
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+// Parses every hand whose header starts in [begin, end) and calls
+// onHand(const ParsedHand&) for each one. A hand may run past `end`; it is
+// read up to the next header or `limit`.
+template <typename HandVisitor>
+void parseHandHistory(const char* begin, const char* end, const char* limit, HandVisitor&& onHand)
+{
+    ParsedHand hand;
+    bool inHand = false;
+    const char* cursor = begin;
+
+    while (cursor < limit)
+    {
+        const char* lineEnd = findByte(cursor, limit, '\n');
+        std::string_view line(cursor, lineEnd - cursor);
+
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+
+        if (startsWith(line, "Hand #"))
+        {
+            if (inHand)
+            {
+                onHand(hand);
+            }
+
+            if (cursor >= end)
+            {
+                return;
+            }
+
+            hand.clear();
+            inHand = parseHandHeader(line, hand);
+        }
+        else if (inHand && !line.empty())
+        {
+            parseHandLine(line, hand);
+        }
+
+        cursor = lineEnd + 1;
+    }
+
+    if (inHand)
+    {
+        onHand(hand);
+    }
+}
+
+// Moves a split point forward to the start of the next line that begins a hand.
+inline const char* nextHandBoundary(const char* split, const char* fileBegin, const char* fileEnd)
+{
+    if (split <= fileBegin)
+    {
+        return fileBegin;
+    }
+
+    const char* cursor = split;
+    while (cursor < fileEnd)
+    {
+        const char* newline = findByte(cursor - 1, fileEnd, '\n');
+        if (newline == fileEnd)
+        {
+            return fileEnd;
+        }
+
+        const char* lineStart = newline + 1;
+        if (startsWith(std::string_view(lineStart, fileEnd - lineStart), "Hand #"))
+        {
+            return lineStart;
+        }
+
+        cursor = lineStart + 1;
+    }
+
+    return fileEnd;
+}
+
+// A run of whole hands: headers start in [begin, end), and the last hand may
+// continue up to limit (the end of the file).
+struct HandHistoryChunk
+{
+    const char* begin;
+    const char* end;
+    const char* limit;
+};
+
+// Cuts a mapped file into one chunk per worker at hand boundaries.
+inline void splitHandHistory(const MappedFile& file, std::vector<HandHistoryChunk>& chunks)
+{
+    const size_t workerCount = getWorkerCount();
+    const char* fileBegin = file.data();
+    const char* fileEnd = file.data() + file.size();
+    const char* chunkBegin = fileBegin;
+
+    for (size_t w = 1; w <= workerCount; w++)
+    {
+        const char* split = w == workerCount ? fileEnd : fileBegin + file.size() * w / workerCount;
+        const char* chunkEnd = nextHandBoundary(std::max(split, chunkBegin), fileBegin, fileEnd);
+
+        if (chunkEnd > chunkBegin)
+        {
+            chunks.push_back({ chunkBegin, chunkEnd, fileEnd });
+            chunkBegin = chunkEnd;
+        }
+    }
+}
+
+struct IngestionSummary
+{
+    long long handCount = 0;
+    long long byteCount = 0;
+    int playersAdded = 0;
+    std::unordered_map<std::string, long long> netCents;
+};
+
+// Maps each file, cuts it into one chunk per worker at hand boundaries and
+// parses the chunks in parallel. Each worker tallies per-player nets into its
+// own table, and the tables are merged once every file is done.
+inline IngestionSummary ingestHandHistoryFiles(const std::vector<std::string>& paths)
+{
+    IngestionSummary summary;
+    std::vector<MappedFile> files;
+
+    for (const std::string& path : paths)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            logEvent(EVENT_HISTORY_UNREADABLE, path);
+            continue;
+        }
+
+        summary.byteCount += file.size();
+        files.push_back(std::move(file));
+    }
+
+    std::vector<HandHistoryChunk> chunks;
+    for (const MappedFile& file : files)
+    {
+        splitHandHistory(file, chunks);
+    }
+
+    std::vector<std::unordered_map<std::string_view, long long>> partialNets(chunks.size());
+    std::vector<long long> partialHandCounts(chunks.size(), 0);
+
+    parallelFor(chunks.size(), [&](size_t c)
+    {
+        std::unordered_map<std::string_view, long long>& nets = partialNets[c];
+
+        parseHandHistory(chunks[c].begin, chunks[c].end, chunks[c].limit, [&](const ParsedHand& hand)
+        {
+            std::array<long long, MAX_HISTORY_SEATS> net = hand.netResults();
+            for (int seat = 0; seat < hand.seatCount; seat++)
+            {
+                nets[hand.seatNames[seat]] += net[seat];
+            }
+
+            partialHandCounts[c]++;
+        });
+    });
+
+    for (size_t c = 0; c < chunks.size(); c++)
+    {
+        summary.handCount += partialHandCounts[c];
+        for (const auto& [name, cents] : partialNets[c])
+        {
+            summary.netCents[std::string(name)] += cents;
+        }
+    }
+
+    // Hashed once so crediting every imported name costs O(1) each, not a
+    // roster scan. The reserve keeps the names the map points into in place
+    // while new players are added.
+    playerList.reserve(playerList.size() + summary.netCents.size());
+    std::unordered_map<std::string_view, int> rosterIndex;
+    rosterIndex.reserve(playerList.size() + summary.netCents.size());
+    for (int i = 1; i < playerList.size(); i++)
+    {
+        rosterIndex.emplace(playerList[i].name, i);
+    }
+
+    // "NONE" is the placeholder player's name, which the menu refuses too.
+    auto reserved = summary.netCents.find("NONE");
+    if (reserved != summary.netCents.end())
+    {
+        std::cerr << "WARNING: Skipped the results of 'NONE' in the imported hands; that name is reserved." << '\n';
+        summary.netCents.erase(reserved);
+    }
+
+    for (const auto& [name, cents] : summary.netCents)
+    {
+        auto found = rosterIndex.find(name);
+        if (found == rosterIndex.end())
+        {
+            addPlayer(name);
+            summary.playersAdded++;
+            found = rosterIndex.emplace(playerList.back().name, static_cast<int>(playerList.size() - 1)).first;
+        }
+
+        playerList[found->second].netCents += cents;
+    }
+
+    return summary;
+}
+
+// Writes a hand back out in the text export format.
+inline void printHandText(const ParsedHand& hand, std::ostream& out)
+{
+    static const char* const VERBS[] = { "posts", "folds", "checks", "calls", "bets", "raises", "collects", "shows" };
+
+    auto printAmount = [&](long long cents)
+    {
+        long long magnitude = cents < 0 ? -cents : cents;
+        out << ' ' << (cents < 0 ? "-" : "") << magnitude / 100 << '.' << static_cast<char>('0' + magnitude % 100 / 10)
+            << static_cast<char>('0' + magnitude % 10);
+    };
+
+    out << "Hand #" << hand.handNumber << ' ' << hand.date / 10000 << '-' << std::setfill('0') << std::setw(2)
+        << hand.date / 100 % 100 << '-' << std::setw(2) << hand.date % 100 << ' ' << std::setw(2) << hand.seconds / 3600
+        << ':' << std::setw(2) << hand.seconds / 60 % 60 << ':' << std::setw(2) << hand.seconds % 60 << std::setfill(' ') << '\n';
+
+    for (int seat = 0; seat < hand.seatCount; seat++)
+    {
+        out << "Seat " << seat + 1 << ": " << hand.seatNames[seat];
+        printAmount(hand.startingStacks[seat]);
+        out << '\n';
+    }
+
+    for (int seat = 0; seat < hand.seatCount; seat++)
+    {
+        if (hand.holeCards[seat][0] >= 0)
+        {
+            out << "Dealt " << hand.seatNames[seat] << ' ' << cardToString(hand.holeCards[seat][0]) << ' '
+                << cardToString(hand.holeCards[seat][1]) << '\n';
+        }
+    }
+
+    int nextBoardCard = 0;
+    for (size_t a = 0; a <= hand.actions.size(); a++)
+    {
+        if (nextBoardCard < hand.boardCount && hand.boardActionIndex[nextBoardCard] <= a)
+        {
+            out << "Board";
+            while (nextBoardCard < hand.boardCount && hand.boardActionIndex[nextBoardCard] <= a)
+            {
+                out << ' ' << cardToString(hand.board[nextBoardCard++]);
+            }
+
+            out << '\n';
+        }
+
+        if (a == hand.actions.size())
+        {
+            break;
+        }
+
+        const HandAction& action = hand.actions[a];
+        out << hand.seatNames[action.seat] << ' ' << VERBS[action.type];
+        if (action.cents != 0)
+        {
+            printAmount(action.cents);
+        }
+
+        out << '\n';
+    }
+}
+
+inline void printIngestionSummary(const IngestionSummary& summary, double seconds)
+{
+    std::cout << "Imported " << summary.handCount << " hands (" << summary.byteCount / 1048576.0 << " MB) in "
+        << seconds << "s, " << summary.netCents.size() << " players (" << summary.playersAdded << " new)" << '\n';
+}
+
+// Lists the players an import touched, biggest winner first, with their net
+// from every history imported this session.
+inline void printIngestionNets(const IngestionSummary& summary)
+{
+    std::vector<std::pair<long long, const std::string*>> nets;
+    nets.reserve(summary.netCents.size());
+    for (int i = 1; i < playerList.size(); i++)
+    {
+        if (summary.netCents.count(playerList[i].name) > 0)
+        {
+            nets.push_back({ playerList[i].netCents, &playerList[i].name });
+        }
+    }
+
+    std::sort(nets.begin(), nets.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::cout << "Net results from imported hands:" << '\n';
+    for (const auto& [cents, name] : nets)
+    {
+        std::cout << *name << ": $" << cents / 100.0 << '\n';
+    }
+}
@@ -0,0 +1,239 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cumulative winnings ranked in an order-statistics treap. Every node keeps
+// its subtree size, so moving a player, finding their rank and walking the
+// top K all cost O(log n) rather than a re-sort of the whole league.
+class Leaderboard
+{
+public:
+    size_t size() const { return subtreeSize(root); }
+
+    bool contains(uint32_t playerId) const
+    {
+        return playerId < playerNodes.size() && playerNodes[playerId] != NO_NODE;
+    }
+
+    long long winningsCents(uint32_t playerId) const
+    {
+        return contains(playerId) ? nodes[playerNodes[playerId]].cents : 0;
+    }
+
+    // Inserts a player or moves them to their new total.
+    void update(uint32_t playerId, long long totalCents)
+    {
+        if (playerId >= playerNodes.size())
+        {
+            playerNodes.resize(playerId + 1, NO_NODE);
+        }
+
+        int32_t node = playerNodes[playerId];
+        if (node != NO_NODE)
+        {
+            root = erase(root, nodes[node].cents, playerId);
+        }
+        else if (!freeNodes.empty())
+        {
+            node = freeNodes.back();
+            freeNodes.pop_back();
+        }
+        else
+        {
+            node = static_cast<int32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+
+        nodes[node] = { totalCents, playerId, nextPriority(), 1, NO_NODE, NO_NODE };
+        playerNodes[playerId] = node;
+
+        int32_t before;
+        int32_t after;
+        split(root, totalCents, playerId, before, after);
+        root = merge(merge(before, node), after);
+    }
+
+    void remove(uint32_t playerId)
+    {
+        if (!contains(playerId))
+        {
+            return;
+        }
+
+        int32_t node = playerNodes[playerId];
+        root = erase(root, nodes[node].cents, playerId);
+        freeNodes.push_back(node);
+        playerNodes[playerId] = NO_NODE;
+    }
+
+    // 1 is the biggest winner; 0 if the player is not ranked.
+    size_t rank(uint32_t playerId) const
+    {
+        if (!contains(playerId))
+        {
+            return 0;
+        }
+
+        long long cents = nodes[playerNodes[playerId]].cents;
+        size_t playersAhead = 0;
+        int32_t node = root;
+
+        while (node != NO_NODE)
+        {
+            if (ranksBefore(cents, playerId, nodes[node]))
+            {
+                node = nodes[node].left;
+            }
+            else
+            {
+                playersAhead += subtreeSize(nodes[node].left);
+                if (nodes[node].playerId == playerId)
+                {
+                    break;
+                }
+
+                playersAhead++;
+                node = nodes[node].right;
+            }
+        }
+
+        return playersAhead + 1;
+    }
+
+    // Share of the league this player is level with or ahead of, in percent.
+    double percentile(uint32_t playerId) const
+    {
+        size_t playerRank = rank(playerId);
+        return playerRank == 0 ? 0.0 : 100.0 * (size() - playerRank + 1) / size();
+    }
+
+    // Calls visit(playerId, cents) for the k biggest winners in rank order.
+    template <typename Visitor>
+    void forEachTop(size_t k, Visitor&& visit) const
+    {
+        std::vector<int32_t> path;
+        int32_t node = root;
+
+        while (k > 0 && (node != NO_NODE || !path.empty()))
+        {
+            while (node != NO_NODE)
+            {
+                path.push_back(node);
+                node = nodes[node].left;
+            }
+
+            node = path.back();
+            path.pop_back();
+            visit(nodes[node].playerId, nodes[node].cents);
+            k--;
+
+            node = nodes[node].right;
+        }
+    }
+
+private:
+    static constexpr int32_t NO_NODE = -1;
+
+    struct Node
+    {
+        long long cents;
+        uint32_t playerId;
+        uint32_t priority;
+        uint32_t size;
+        int32_t left;
+        int32_t right;
+    };
+
+    // Higher winnings rank first, ties go to the lower id.
+    static bool ranksBefore(long long cents, uint32_t playerId, const Node& other)
+    {
+        return cents > other.cents || (cents == other.cents && playerId < other.playerId);
+    }
+
+    uint32_t subtreeSize(int32_t node) const
+    {
+        return node == NO_NODE ? 0 : nodes[node].size;
+    }
+
+    void updateSize(int32_t node)
+    {
+        nodes[node].size = 1 + subtreeSize(nodes[node].left) + subtreeSize(nodes[node].right);
+    }
+
+    uint32_t nextPriority()
+    {
+        priorityState ^= priorityState << 13;
+        priorityState ^= priorityState >> 17;
+        priorityState ^= priorityState << 5;
+        return priorityState;
+    }
+
+    // Splits into the nodes ranked before (cents, playerId) and the rest.
+    void split(int32_t node, long long cents, uint32_t playerId, int32_t& before, int32_t& after)
+    {
+        if (node == NO_NODE)
+        {
+            before = after = NO_NODE;
+            return;
+        }
+
+        if (ranksBefore(nodes[node].cents, nodes[node].playerId, Node{ cents, playerId, 0, 0, NO_NODE, NO_NODE }))
+        {
+            split(nodes[node].right, cents, playerId, nodes[node].right, after);
+            before = node;
+        }
+        else
+        {
+            split(nodes[node].left, cents, playerId, before, nodes[node].left);
+            after = node;
+        }
+
+        updateSize(node);
+    }
+
+    int32_t merge(int32_t first, int32_t second)
+    {
+        if (first == NO_NODE || second == NO_NODE)
+        {
+            return first == NO_NODE ? second : first;
+        }
+
+        if (nodes[first].priority > nodes[second].priority)
+        {
+            nodes[first].right = merge(nodes[first].right, second);
+            updateSize(first);
+            return first;
+        }
+
+        nodes[second].left = merge(first, nodes[second].left);
+        updateSize(second);
+        return second;
+    }
+
+    int32_t erase(int32_t node, long long cents, uint32_t playerId)
+    {
+        if (nodes[node].playerId == playerId)
+        {
+            return merge(nodes[node].left, nodes[node].right);
+        }
+
+        if (ranksBefore(cents, playerId, nodes[node]))
+        {
+            nodes[node].left = erase(nodes[node].left, cents, playerId);
+        }
+        else
+        {
+            nodes[node].right = erase(nodes[node].right, cents, playerId);
+        }
+
+        updateSize(node);
+        return node;
+    }
+
+    std::vector<Node> nodes;
+    std::vector<int32_t> freeNodes;
+    std::vector<int32_t> playerNodes; // by player id
+    int32_t root = NO_NODE;
+    uint32_t priorityState = 2463534242u;
+};
@@ -0,0 +1,759 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "PokerPal.h"
+#include "Tracing.h"
+#include "VersionedLedger.h"
+
+#ifdef __linux__
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+const std::string DEFAULT_LEDGER_SOCKET = "pokerpal.sock";
+
+constexpr int LEDGER_EPOLL_EVENTS = 64;
+constexpr size_t LEDGER_READ_SIZE = 64 * 1024;
+constexpr size_t LEDGER_MAX_LINE = 4096;
+constexpr size_t LEDGER_OUTPUT_LIMIT = 1024 * 1024; // stop reading a client whose replies pile up
+constexpr size_t LEDGER_INLINE_REPORT_LIMIT = 4096;  // larger rosters are reported from a snapshot
+
+// Hosts playerList and the pot for any number of local terminals. Clients
+// send newline-terminated commands over a Unix domain socket and get one
+// reply line per command, in order, so they can pipeline as many commands as
+// they like without waiting:
+//
+//   PING                              OK
+//   ADD <name>                        OK
+//   REMOVE <name>                     OK
+//   CHIPS <name> <white> ... <black>  OK <cents>
+//   GET <name>                        OK <white> <red> <blue> <green> <black> <cents>
+//   POT [<cents> | DEFAULT]           OK <cents>
+//   TOTAL                             OK <winnings cents> <pot cents>
+//   LIST                              OK <count>, then one "<name> <cents>" line per player
+//   QUIT                              OK, then the server hangs up
+//   SHUTDOWN                          OK, then the server saves and exits
+//
+// Failures reply "ERR <reason>". Everything runs on one thread around a
+// level-triggered epoll loop: each wakeup reads whatever a client has sent,
+// answers every complete line into its output buffer and flushes that with
+// a single send, so a pipelined batch costs two system calls. SIGINT and
+// SIGTERM arrive through a signalfd and stop the loop like SHUTDOWN.
+//
+// The roster lives in a VersionedLedger while serving and is copied back to
+// playerList when the server stops. Players keep their ledger slot for as
+// long as they are on the roster: REMOVE empties the slot and the next ADD
+// reuses it, so neither moves anyone else. LIST therefore goes in slot
+// order, and playerList gets back the order players were added in when it
+// is copied back. LIST and TOTAL over a large roster are
+// handed to a report thread with a snapshot, so chip updates from other
+// clients carry on while the report is written. The requesting client's
+// later commands wait for the report to keep its replies in order.
+class LedgerServer
+{
+public:
+    LedgerServer() = default;
+    LedgerServer(const LedgerServer&) = delete;
+    LedgerServer& operator=(const LedgerServer&) = delete;
+
+    ~LedgerServer()
+    {
+        stopReportThread();
+
+#ifdef __linux__
+        for (auto& [descriptor, connection] : connections)
+        {
+            close(descriptor);
+        }
+        for (int descriptor : { listener, signals, events, reportsReady })
+        {
+            if (descriptor >= 0)
+            {
+                close(descriptor);
+            }
+        }
+        if (listener >= 0)
+        {
+            unlink(socketPath.c_str());
+        }
+#endif
+    }
+
+    bool start(const std::string& path)
+    {
+#ifdef __linux__
+        socketPath = path;
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            std::cerr << "ERROR: Socket path '" << path << "' is too long!" << '\n';
+            return false;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        // A socket file left behind by a server that did not shut down cleanly.
+        unlink(path.c_str());
+
+        listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || listen(listener, SOMAXCONN) != 0)
+        {
+            std::cerr << "ERROR: Unable to listen on '" << path << "': " << std::strerror(errno) << '\n';
+            return false;
+        }
+
+        sigset_t stopSignals;
+        sigemptyset(&stopSignals);
+        sigaddset(&stopSignals, SIGINT);
+        sigaddset(&stopSignals, SIGTERM);
+        sigprocmask(SIG_BLOCK, &stopSignals, nullptr);
+        signals = signalfd(-1, &stopSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+        events = epoll_create1(EPOLL_CLOEXEC);
+        reportsReady = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (signals < 0 || events < 0 || reportsReady < 0 || !watch(listener, EPOLLIN, EPOLL_CTL_ADD)
+            || !watch(signals, EPOLLIN, EPOLL_CTL_ADD) || !watch(reportsReady, EPOLLIN, EPOLL_CTL_ADD))
+        {
+            std::cerr << "ERROR: Unable to start the ledger server: " << std::strerror(errno) << '\n';
+            return false;
+        }
+
+        for (size_t i = 0; i < playerList.size(); i++)
+        {
+            ledger.push_back(playerList[i]);
+            playerSlots[playerList[i].name] = i;
+            addedAt.push_back(addCount++);
+        }
+        playerSlots.erase("NONE");
+        ledger.publish();
+
+        reportThread = std::thread([this]() { produceReports(); });
+        return true;
+#else
+        std::cerr << "ERROR: The ledger server needs Linux (epoll and Unix domain sockets)." << '\n';
+        return false;
+#endif
+    }
+
+    // Serves clients until SHUTDOWN, SIGINT or SIGTERM.
+    void run()
+    {
+#ifdef __linux__
+        epoll_event ready[LEDGER_EPOLL_EVENTS];
+
+        while (!stopping)
+        {
+            int readyCount = epoll_wait(events, ready, LEDGER_EPOLL_EVENTS, -1);
+            if (readyCount < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                std::cerr << "ERROR: epoll_wait failed: " << std::strerror(errno) << '\n';
+                return;
+            }
+
+            for (int i = 0; i < readyCount && !stopping; i++)
+            {
+                int descriptor = ready[i].data.fd;
+
+                if (descriptor == listener)
+                {
+                    acceptClients();
+                }
+                else if (descriptor == signals)
+                {
+                    stopping = true;
+                }
+                else if (descriptor == reportsReady)
+                {
+                    deliverReports();
+                }
+                else if (connections.count(descriptor) > 0)
+                {
+                    serviceClient(descriptor, ready[i].events);
+                }
+            }
+        }
+
+        // Let clients read the replies they are owed, including SHUTDOWN's.
+        for (auto& [descriptor, connection] : connections)
+        {
+            flush(descriptor, connection);
+        }
+
+        stopReportThread();
+
+        std::vector<size_t> occupied;
+        occupied.reserve(playerSlots.size());
+        for (size_t slot = 1; slot < ledger.size(); slot++)
+        {
+            if (!ledger[slot].name.empty())
+            {
+                occupied.push_back(slot);
+            }
+        }
+        std::sort(occupied.begin(), occupied.end(), [&](size_t a, size_t b) { return addedAt[a] < addedAt[b]; });
+
+        playerList.assign(1, ledger[0]);
+        for (size_t slot : occupied)
+        {
+            playerList.push_back(ledger[slot]);
+        }
+#endif
+    }
+
+    long long potCents() const { return getPotCents(); }
+    long long commandCount() const { return commands; }
+    bool rosterChanged() const { return rosterEdited; }
+    bool sessionChanged() const { return sessionEdited; }
+
+private:
+    struct Connection
+    {
+        std::string input;
+        size_t inputStart = 0;
+        std::string output;
+        size_t outputStart = 0;
+        int descriptor = -1;
+        uint64_t serial = 0; // tells a reused descriptor from the client a report was for
+        uint32_t interest = 0;
+        bool hangUp = false;
+        bool inputClosed = false; // answer what was sent, then hang up
+        bool awaitingReport = false;
+    };
+
+    struct ReportJob
+    {
+        int descriptor;
+        uint64_t serial;
+        std::string command;
+        size_t players;
+        long long pot;
+        LedgerSnapshot snapshot;
+        std::string output;
+    };
+
+    struct NameHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+    };
+
+#ifdef __linux__
+    bool watch(int descriptor, uint32_t interest, int operation)
+    {
+        epoll_event event{};
+        event.events = interest;
+        event.data.fd = descriptor;
+
+        return epoll_ctl(events, operation, descriptor, &event) == 0;
+    }
+
+    void acceptClients()
+    {
+        for (;;)
+        {
+            int client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client < 0)
+            {
+                return;
+            }
+
+            if (!watch(client, EPOLLIN, EPOLL_CTL_ADD))
+            {
+                close(client);
+                continue;
+            }
+
+            Connection& connection = connections[client];
+            connection.descriptor = client;
+            connection.serial = ++connectionCount;
+            connection.interest = EPOLLIN;
+        }
+    }
+
+    void serviceClient(int descriptor, uint32_t ready)
+    {
+        Connection& connection = connections[descriptor];
+        bool open = true;
+
+        if (ready & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        {
+            open = receive(descriptor, connection);
+        }
+        executeLines(connection);
+
+        // A hang-up after end of input means nobody is left to read replies.
+        open = open && !((ready & (EPOLLHUP | EPOLLERR)) && connection.inputClosed);
+
+        open = flush(descriptor, connection) && open;
+        bool pending = connection.outputStart < connection.output.size();
+
+        if (!open || ((connection.hangUp || connection.inputClosed) && !pending && !connection.awaitingReport))
+        {
+            close(descriptor);
+            connections.erase(descriptor);
+            return;
+        }
+
+        // Wait for a backlog to drain before taking more input, and only ask
+        // for writability while there is something left to send.
+        bool backlogged = connection.output.size() - connection.outputStart > LEDGER_OUTPUT_LIMIT;
+        bool pauseReading = backlogged || connection.hangUp || connection.inputClosed || connection.awaitingReport;
+        uint32_t interest = (pauseReading ? 0u : EPOLLIN) | (pending ? EPOLLOUT : 0u);
+        if (interest != connection.interest)
+        {
+            watch(descriptor, interest, EPOLL_CTL_MOD);
+            connection.interest = interest;
+        }
+    }
+
+    // Returns false once the client has gone away.
+    bool receive(int descriptor, Connection& connection)
+    {
+        size_t used = connection.input.size();
+        connection.input.resize(used + LEDGER_READ_SIZE);
+        ssize_t received = recv(descriptor, connection.input.data() + used, LEDGER_READ_SIZE, 0);
+        connection.input.resize(used + (received > 0 ? received : 0));
+        connection.inputClosed |= received == 0;
+
+        return received >= 0 || errno == EAGAIN || errno == EINTR;
+    }
+
+    void executeLines(Connection& connection)
+    {
+        std::string_view pending(connection.input);
+        size_t lineStart = connection.inputStart;
+
+        for (size_t lineEnd = pending.find('\n', lineStart);
+            lineEnd != std::string_view::npos && !connection.hangUp && !connection.awaitingReport;
+            lineEnd = pending.find('\n', lineStart))
+        {
+            std::string_view line = pending.substr(lineStart, lineEnd - lineStart);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.remove_suffix(1);
+            }
+
+            execute(line, connection);
+            lineStart = lineEnd + 1;
+        }
+
+        if (!connection.awaitingReport && connection.input.size() - lineStart > LEDGER_MAX_LINE)
+        {
+            connection.output += "ERR line too long\n";
+            connection.hangUp = true;
+        }
+
+        // Keep only the unfinished line, moving it down once the consumed
+        // part dominates the buffer.
+        if (lineStart == connection.input.size())
+        {
+            connection.input.clear();
+            lineStart = 0;
+        }
+        else if (lineStart > connection.input.size() / 2)
+        {
+            connection.input.erase(0, lineStart);
+            lineStart = 0;
+        }
+        connection.inputStart = lineStart;
+    }
+
+    // Returns false once the client has gone away.
+    bool flush(int descriptor, Connection& connection)
+    {
+        while (connection.outputStart < connection.output.size())
+        {
+            ssize_t sent = send(descriptor, connection.output.data() + connection.outputStart,
+                connection.output.size() - connection.outputStart, MSG_NOSIGNAL);
+
+            if (sent < 0)
+            {
+                return errno == EAGAIN || errno == EINTR;
+            }
+
+            connection.outputStart += sent;
+        }
+
+        connection.output.clear();
+        connection.outputStart = 0;
+        return true;
+    }
+
+    // Hands finished reports to their clients and resumes the commands they
+    // sent after them.
+    void deliverReports()
+    {
+        uint64_t wakeups;
+        read(reportsReady, &wakeups, sizeof(wakeups));
+
+        std::vector<ReportJob> finished;
+        {
+            std::lock_guard<std::mutex> lock(reportMutex);
+            finished.swap(finishedReports);
+        }
+        ledger.reclaim();
+
+        for (ReportJob& job : finished)
+        {
+            auto connection = connections.find(job.descriptor);
+            if (connection != connections.end() && connection->second.serial == job.serial)
+            {
+                connection->second.output += job.output;
+                connection->second.awaitingReport = false;
+                serviceClient(job.descriptor, 0);
+            }
+        }
+    }
+#endif
+
+    void produceReports()
+    {
+        std::unique_lock<std::mutex> lock(reportMutex);
+
+        for (;;)
+        {
+            reportQueued.wait(lock, [&]() { return reportThreadStopping || !reportJobs.empty(); });
+            if (reportThreadStopping)
+            {
+                return;
+            }
+
+            ReportJob job = std::move(reportJobs.front());
+            reportJobs.pop_front();
+            lock.unlock();
+
+            writeReport(job.command, job.snapshot, job.players, job.pot, job.output);
+            job.snapshot = LedgerSnapshot();
+
+            lock.lock();
+            finishedReports.push_back(std::move(job));
+#ifdef __linux__
+            uint64_t wakeup = 1;
+            write(reportsReady, &wakeup, sizeof(wakeup));
+#endif
+        }
+    }
+
+    void stopReportThread()
+    {
+        if (!reportThread.joinable())
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(reportMutex);
+            reportThreadStopping = true;
+        }
+        reportQueued.notify_one();
+        reportThread.join();
+
+        reportJobs.clear();
+        finishedReports.clear();
+    }
+
+    // LIST or TOTAL over either the live ledger or a snapshot of it, which
+    // holds `players` players among its empty slots.
+    template <typename Roster>
+    static void writeReport(std::string_view command, const Roster& roster, size_t players, long long pot, std::string& output)
+    {
+        TRACE_SPAN("writeReport");
+        if (command == "LIST")
+        {
+            output += "OK ";
+            appendNumber(output, static_cast<long long>(players));
+            output += '\n';
+
+            for (size_t i = 1; i < roster.size(); i++)
+            {
+                if (roster[i].name.empty())
+                {
+                    continue;
+                }
+
+                output.append(roster[i].name).append(" ");
+                appendNumber(output, calculateWinningsCents(roster[i]));
+                output += '\n';
+            }
+        }
+        else
+        {
+            long long total = 0;
+            for (size_t i = 1; i < roster.size(); i++)
+            {
+                total += calculateWinningsCents(roster[i]);
+            }
+
+            output += "OK ";
+            appendNumber(output, total);
+            output += ' ';
+            appendNumber(output, pot);
+            output += '\n';
+        }
+    }
+
+    static std::string_view nextWord(std::string_view& line)
+    {
+        size_t start = line.find_first_not_of(' ');
+        if (start == std::string_view::npos)
+        {
+            line = {};
+            return {};
+        }
+
+        size_t end = std::min(line.find(' ', start), line.size());
+        std::string_view word = line.substr(start, end - start);
+        line.remove_prefix(end);
+
+        return word;
+    }
+
+    static bool parseCount(std::string_view word, long long& value)
+    {
+        auto [end, error] = std::from_chars(word.data(), word.data() + word.size(), value);
+        return error == std::errc() && end == word.data() + word.size() && value >= 0;
+    }
+
+    static void appendNumber(std::string& output, long long value)
+    {
+        char digits[24];
+        auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+        output.append(digits, end);
+    }
+
+    // The player's ledger index, or 0 (the NONE player) when unknown.
+    size_t findSlot(std::string_view name) const
+    {
+        auto slot = playerSlots.find(name);
+        return slot == playerSlots.end() ? 0 : slot->second;
+    }
+
+    void execute(std::string_view line, Connection& connection)
+    {
+        std::string& output = connection.output;
+        std::string_view command = nextWord(line);
+        std::string_view name = nextWord(line);
+        commands++;
+
+        if (command == "PING")
+        {
+            output += "OK\n";
+        }
+        else if (command == "GET" || command == "CHIPS")
+        {
+            size_t slot = findSlot(name);
+            long long counts[5];
+            int countsRead = 0;
+
+            while (countsRead < 5 && parseCount(nextWord(line), counts[countsRead]))
+            {
+                countsRead++;
+            }
+
+            if (slot == 0)
+            {
+                output.append("ERR unknown player '").append(name).append("'\n");
+                return;
+            }
+            if (command == "CHIPS")
+            {
+                if (countsRead < 5 || std::any_of(counts, counts + 5, [](long long count) { return count > INT_MAX; }))
+                {
+                    output += "ERR expected five chip counts\n";
+                    return;
+                }
+
+                Player& player = ledger.edit(slot);
+                player.whiteChips = static_cast<int>(counts[0]);
+                player.redChips = static_cast<int>(counts[1]);
+                player.blueChips = static_cast<int>(counts[2]);
+                player.greenChips = static_cast<int>(counts[3]);
+                player.blackChips = static_cast<int>(counts[4]);
+                player.chipsEntered = true;
+                sessionEdited = true;
+            }
+
+            const Player& player = ledger[slot];
+
+            output += "OK ";
+            if (command == "GET")
+            {
+                for (int chips : { player.whiteChips, player.redChips, player.blueChips, player.greenChips, player.blackChips })
+                {
+                    appendNumber(output, chips);
+                    output += ' ';
+                }
+            }
+            appendNumber(output, calculateWinningsCents(player));
+            output += '\n';
+        }
+        else if (command == "POT")
+        {
+            long long cents = 0;
+            if (name == "DEFAULT")
+            {
+                // Menu option 5's default: every player on the roster buys in.
+                setPotCents(static_cast<long long>(playerSlots.size()) * DEFAULT_POT_CENTS_PER_PLAYER);
+                sessionEdited = true;
+            }
+            else if (!name.empty())
+            {
+                if (!parseCount(name, cents))
+                {
+                    output += "ERR expected a pot in cents\n";
+                    return;
+                }
+
+                setPotCents(cents);
+                sessionEdited = true;
+            }
+
+            output += "OK ";
+            appendNumber(output, getPotCents());
+            output += '\n';
+        }
+        else if (command == "LIST" || command == "TOTAL")
+        {
+            if (ledger.size() <= LEDGER_INLINE_REPORT_LIMIT)
+            {
+                writeReport(command, ledger, playerSlots.size(), getPotCents(), output);
+                return;
+            }
+
+            ledger.publish();
+            {
+                std::lock_guard<std::mutex> lock(reportMutex);
+                reportJobs.push_back({ connection.descriptor, connection.serial, std::string(command), playerSlots.size(),
+                    getPotCents(), ledger.snapshot(), "" });
+            }
+            reportQueued.notify_one();
+            connection.awaitingReport = true;
+        }
+        else if (command == "ADD")
+        {
+            if (name.empty() || name == "NONE")
+            {
+                output += "ERR expected a player name\n";
+            }
+            else if (findSlot(name) != 0)
+            {
+                output.append("ERR player '").append(name).append("' already exists\n");
+            }
+            else
+            {
+                Player player;
+                player.name = name;
+
+                size_t slot = ledger.size();
+                if (freeSlots.empty())
+                {
+                    ledger.push_back(player);
+                    addedAt.push_back(addCount++);
+                }
+                else
+                {
+                    slot = freeSlots.back();
+                    freeSlots.pop_back();
+                    ledger.edit(slot) = player;
+                    addedAt[slot] = addCount++;
+                }
+
+                playerSlots[player.name] = slot;
+                rosterEdited = true;
+                output += "OK\n";
+            }
+        }
+        else if (command == "REMOVE")
+        {
+            auto slot = playerSlots.find(name);
+            if (slot == playerSlots.end())
+            {
+                output.append("ERR unknown player '").append(name).append("'\n");
+            }
+            else if (playerSlots.size() == 1)
+            {
+                output += "ERR must be at least one player\n";
+            }
+            else
+            {
+                // An empty name marks the slot free.
+                Player& player = ledger.edit(slot->second);
+                player = Player();
+                player.name.clear();
+
+                freeSlots.push_back(slot->second);
+                playerSlots.erase(slot);
+                rosterEdited = true;
+                output += "OK\n";
+            }
+        }
+        else if (command == "QUIT")
+        {
+            output += "OK\n";
+            connection.hangUp = true;
+        }
+        else if (command == "SHUTDOWN")
+        {
+            output += "OK\n";
+            stopping = true;
+        }
+        else if (!command.empty())
+        {
+            output.append("ERR unknown command '").append(command).append("'\n");
+        }
+        else
+        {
+            commands--; // blank line
+        }
+    }
+
+    VersionedLedger ledger;
+    std::string socketPath;
+    int listener = -1;
+    int signals = -1;
+    int events = -1;
+    int reportsReady = -1;
+    bool stopping = false;
+    std::unordered_map<int, Connection> connections;
+    uint64_t connectionCount = 0;
+    std::unordered_map<std::string, size_t, NameHash, std::equal_to<>> playerSlots;
+    std::vector<size_t> freeSlots;
+    std::vector<uint64_t> addedAt; // per slot, when its player was added, to restore playerList's order
+    uint64_t addCount = 0;
+    long long commands = 0;
+    bool rosterEdited = false;
+    bool sessionEdited = false;
+
+    std::mutex reportMutex;
+    std::condition_variable reportQueued;
+    std::deque<ReportJob> reportJobs;
+    std::vector<ReportJob> finishedReports;
+    bool reportThreadStopping = false;
+    std::thread reportThread;
+};
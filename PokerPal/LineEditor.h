@@ -0,0 +1,187 @@
+#pragma once
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "NameIndex.h"
+
+#ifdef _WIN32
+#include <conio.h>
+#include <io.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+constexpr size_t COMPLETION_LIST_LIMIT = 20;
+
+// Switches the terminal to unbuffered, unechoed input for its lifetime.
+class RawTerminalMode
+{
+public:
+    RawTerminalMode()
+    {
+#ifndef _WIN32
+        if (tcgetattr(STDIN_FILENO, &savedSettings) == 0)
+        {
+            termios raw = savedSettings;
+            raw.c_lflag &= ~(ICANON | ECHO);
+            raw.c_cc[VMIN] = 1;
+            raw.c_cc[VTIME] = 0;
+            active = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+        }
+#endif
+    }
+
+    RawTerminalMode(const RawTerminalMode&) = delete;
+    RawTerminalMode& operator=(const RawTerminalMode&) = delete;
+
+    ~RawTerminalMode()
+    {
+#ifndef _WIN32
+        if (active)
+        {
+            tcsetattr(STDIN_FILENO, TCSANOW, &savedSettings);
+        }
+#endif
+    }
+
+private:
+#ifndef _WIN32
+    termios savedSettings{};
+    bool active = false;
+#endif
+};
+
+inline bool isInteractiveInput()
+{
+#ifdef _WIN32
+    return _isatty(_fileno(stdin)) != 0;
+#else
+    return isatty(STDIN_FILENO) != 0;
+#endif
+}
+
+inline int readKey()
+{
+#ifdef _WIN32
+    int key = _getch();
+    if (key == 0 || key == 224) // arrow and function keys arrive as two codes
+    {
+        _getch();
+        return 0;
+    }
+
+    return key;
+#else
+    int key = std::getchar();
+    if (key == 27) // arrow, Delete and function keys arrive as escape sequences
+    {
+        int next = std::getchar();
+        if (next == '[') // CSI: parameters, then a final byte from '@' to '~'
+        {
+            do
+            {
+                next = std::getchar();
+            } while (next != EOF && (next < '@' || next > '~'));
+        }
+        else if (next == 'O') // SS3: one more byte
+        {
+            std::getchar();
+        }
+
+        return 0;
+    }
+
+    return key;
+#endif
+}
+
+// Tab extends the word to the longest prefix all matching names share. When
+// it cannot extend it any further, the matches are listed instead.
+inline void completeWord(const NameIndex& names, std::string& word)
+{
+    std::string completed = names.commonPrefix(word);
+
+    if (completed.size() > word.size())
+    {
+        std::cout << completed.substr(word.size());
+        word = completed;
+        return;
+    }
+
+    std::vector<std::string> matches = names.complete(word, COMPLETION_LIST_LIMIT + 1);
+    if (matches.size() <= 1)
+    {
+        std::cout << '\a';
+        return;
+    }
+
+    std::cout << '\n';
+    for (size_t i = 0; i < matches.size() && i < COMPLETION_LIST_LIMIT; i++)
+    {
+        std::cout << matches[i] << "  ";
+    }
+    if (matches.size() > COMPLETION_LIST_LIMIT)
+    {
+        std::cout << "...";
+    }
+
+    std::cout << '\n' << "> " << word;
+}
+
+// Reads one word, completing player names on Tab. Input that is not a
+// terminal (piped or redirected) is read as a plain word.
+inline std::string readCompletedWord(const NameIndex& names)
+{
+    if (!isInteractiveInput())
+    {
+        std::string word;
+        std::cin >> word;
+        return word;
+    }
+
+    RawTerminalMode rawMode;
+    std::string word;
+
+    for (;;)
+    {
+        std::cout.flush();
+        int key = readKey();
+
+        if (key == EOF || key == '\r' || key == '\n')
+        {
+            // Skip the newline left over from the previous prompt.
+            if (word.empty() && key != EOF)
+            {
+                continue;
+            }
+
+            std::cout << '\n';
+            return word;
+        }
+        else if (key == '\t')
+        {
+            completeWord(names, word);
+        }
+        else if (key == 127 || key == '\b')
+        {
+            // Removes a whole UTF-8 character: its continuation bytes, then its lead.
+            while (!word.empty() && (static_cast<unsigned char>(word.back()) & 0xC0) == 0x80)
+            {
+                word.pop_back();
+            }
+            if (!word.empty())
+            {
+                word.pop_back();
+                std::cout << "\b \b";
+            }
+        }
+        else if (key > ' ' && key != 127) // bytes from 0x80 up are parts of UTF-8 names
+        {
+            word += static_cast<char>(key);
+            std::cout << static_cast<char>(key);
+        }
+    }
+}
@@ -1,34 +1,259 @@
+#include "BinaryHistory.h"
+#include "BulkChipEntry.h"
+#include "HandHistory.h"
+#include "LedgerServer.h"
+#include "PlayerStats.h"
 #include "PokerPal.h"
-
-int main()
+#include "PushFold.h"
+#include "ReplicatedLedger.h"
+#include "RosterWatcher.h"
+#include "SessionStore.h"
+#include "SharedLedger.h"
+#include "Simulator.h"
+#include "WinningsReport.h"
+#include "Workload.h"
+
+int main(int argc, char* argv[])
 {
+    std::string command = argc > 1 ? argv[1] : "";
+
+    if (command == "--build-equity")
+    {
+        return generateEquityFile(PREFLOP_EQUITY_FILE, EQUITY_FILE_SAMPLES_PER_MATCHUP) ? 0 : 1;
+    }
+    else if (command == "--simulate" && argc > 2)
+    {
+        std::cout << std::fixed << std::setprecision(2);
+        long long handsPerTable = 0;
+        uint64_t seed = 1;
+        if (!parseWorkloadArgument(argv[2], "number of hands", handsPerTable)
+            || (argc > 3 && !parseWorkloadArgument(argv[3], "seed", seed)))
+        {
+            return 1;
+        }
+        if (handsPerTable <= 0)
+        {
+            std::cerr << "ERROR: The number of hands per table must be positive!" << '\n';
+            return 1;
+        }
+
+        runSimulation(handsPerTable, seed);
+
+        for (int i = 1; i < playerList.size(); i++)
+        {
+            std::cout << playerList[i].name << ": $" << calculateWinnings(playerList[i]) << '\n';
+        }
+
+        return 0;
+    }
+    else if (command == "--ingest" && argc > 2)
+    {
+        std::cout << std::fixed << std::setprecision(2);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> paths(argv + 2, argv + argc);
+        IngestionSummary summary = ingestHandHistoryFiles(paths);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        printIngestionSummary(summary, elapsed.count());
+        for (const std::string& path : paths)
+        {
+            convertHandHistoryFile(path, path + BINARY_HISTORY_EXTENSION);
+        }
+
+        printIngestionNets(summary);
+        if (summary.playersAdded > 0)
+        {
+            savePlayerList();
+        }
+
+#ifdef POKERPAL_INSTRUMENTATION
+        printLookupInstrumentation();
+#endif
+
+        return 0;
+    }
+    else if (command == "--stats" && argc > 2)
+    {
+        std::cout << std::fixed << std::setprecision(2);
+        runPlayerStatsReport(std::vector<std::string>(argv + 2, argv + argc));
+
+        return 0;
+    }
+    else if (command == "--winnings" && argc > 2)
+    {
+        std::cout << std::fixed << std::setprecision(2);
+        return runWinningsQuery(argv[2], argc > 3 ? argv[3] : "", argc > 4 ? argv[4] : "");
+    }
+    else if (command == "--leaderboard")
+    {
+        std::cout << std::fixed << std::setprecision(2);
+        size_t topCount = LEADERBOARD_TOP_COUNT;
+        if (argc > 2 && !parseWorkloadArgument(argv[2], "leaderboard size", topCount))
+        {
+            return 1;
+        }
+
+        printLeaderboard(topCount);
+
+        return 0;
+    }
+    else if (command == "--history" && argc > 4)
+    {
+        std::cout << std::fixed << std::setprecision(2);
+        return runHistoryQuery(argv[2], argv[3], argv[4]);
+    }
+    else if (command == "--serve")
+    {
+        std::string socketPath = argc > 2 ? argv[2] : DEFAULT_LEDGER_SOCKET;
+        LedgerServer server;
+        if (!server.start(socketPath))
+        {
+            return 1;
+        }
+
+        std::cout << "Serving the ledger on '" << socketPath << "'. Send SHUTDOWN or press Ctrl+C to stop." << '\n';
+        auto start = std::chrono::steady_clock::now();
+        server.run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "Served " << server.commandCount() << " commands in " << std::fixed << std::setprecision(2)
+            << elapsed.count() << "s." << '\n';
+
+        if (server.sessionChanged() && getSessionStore().recordSession(getTodaysDate(), server.potCents()))
+        {
+            std::cout << "Saved session " << getSessionStore().sessionCount() << " to '" << SESSION_STORE_DIRECTORY << "'." << '\n';
+        }
+        if (server.rosterChanged())
+        {
+            savePlayerList();
+        }
+
+        return 0;
+    }
+
+    else if ((command == "--replica-export" || command == "--replica-full") && argc > 2)
+    {
+        return runReplicaExport(argv[2], command == "--replica-full") ? 0 : 1;
+    }
+    else if (command == "--replica-merge" && argc > 2)
+    {
+        return runReplicaMerge(std::vector<std::string>(argv + 2, argv + argc)) ? 0 : 1;
+    }
+    else if (command == "--workload" && argc > 4)
+    {
+        WorkloadProfile profile;
+        if (!parseWorkloadArgument(argv[2], "seed", profile.seed) || !parseWorkloadArgument(argv[3], "player count", profile.players)
+            || !parseWorkloadArgument(argv[4], "command count", profile.commands))
+        {
+            return 1;
+        }
+
+        return writeWorkload(profile, argc > 5 ? argv[5] : "-") ? 0 : 1;
+    }
+    else if (command == "--replay" && argc > 2)
+    {
+        std::cout << std::fixed << std::setprecision(2);
+        double commandsPerSecond = 0.0;
+        if (argc > 3 && !parseWorkloadArgument(argv[3], "rate in commands per second", commandsPerSecond))
+        {
+            return 1;
+        }
+        if (!std::isfinite(commandsPerSecond) || commandsPerSecond < 0.0)
+        {
+            std::cerr << "ERROR: The replay rate must be 0 (flat out) or a positive number of commands per second!" << '\n';
+            return 1;
+        }
+
+        return runWorkloadReplay(argv[2], commandsPerSecond, argc > 4 ? argv[4] : DEFAULT_LEDGER_SOCKET) ? 0 : 1;
+    }
+
     std::cout << std::fixed << std::setprecision(2); // set floating point precision
     std::cerr << std::fixed << std::setprecision(2); // set floating point precision
 
     bool exit = false;
-    float potAmount = 0.0f;
     bool playerListChanged = false;
+    bool sessionChanged = false;
 
     printBanner();
 
+    RosterWatcher rosterWatcher;
+    rosterWatcher.start(PLAYER_LIST_FILE);
+
+    // With --shared, every command starts from and publishes to a ledger
+    // other PokerPal processes on this host can see.
+    bool shared = command == "--shared";
+    SharedLedger sharedLedger;
+    if (shared && !sharedLedger.open(argc > 2 ? argv[2] : DEFAULT_SHARED_LEDGER, playerList))
+    {
+        return 1;
+    }
+
+    SharedLedgerSync sharedSync(sharedLedger);
+    if (shared)
+    {
+        sharedSync.pull();
+    }
+
+    // With --replica, the roster and chips live in this directory's replica
+    // log, every command's changes join the outbox for --replica-export, and
+    // deltas dropped into replica.inbox are merged between commands.
+    bool replicated = command == "--replica";
+    ReplicatedLedger replicatedLedger;
+    if (replicated && !replicatedLedger.open())
+    {
+        return 1;
+    }
+
+    ReplicaSync replicaSync(replicatedLedger);
+    if (replicated)
+    {
+        playerListChanged = replicaSync.pull();
+        replicaSync.push();
+    }
+
     while (playerList.size() > 1 && !exit)
     {
+        RosterChanges rosterChanges = rosterWatcher.poll();
+        if (rosterChanges.added > 0 || rosterChanges.removed > 0)
+        {
+            std::cout << "Reloaded " << PLAYER_LIST_FILE << ": " << rosterChanges.added << " added, "
+                << rosterChanges.removed << " removed." << '\n' << '\n';
+        }
+
+        size_t deltasMerged = replicated ? replicaSync.mergeInbox() : 0;
+        if (deltasMerged > 0)
+        {
+            std::cout << "Merged " << deltasMerged << " replica delta(s) from " << REPLICA_INBOX_DIRECTORY << "." << '\n' << '\n';
+            playerListChanged = true;
+        }
+
+        // Tonight's errors and warnings come before the next menu.
+        flushEventLog();
         printPlayers();
         printMenu();
 
         int menuChoice = getIntegerInput(MAIN_MENU);
+#ifdef POKERPAL_ALLOCATION_PROFILER
+        AllocationScope commandScope(getCommandAllocationSite(menuChoice));
+#endif
+        if (shared)
+        {
+            sharedSync.pull();
+        }
 
         switch (menuChoice)
         {
         case 1: // Add player
         {
+            TRACE_SPAN("menu 1: add player");
             std::cout << "Enter the name of the new player (no spaces): ";
             std::string newPlrName = getStringInput(ADD_PLAYER);
 
-            Player newPlayer;
-            newPlayer.name = newPlrName;
-            playerList.push_back(newPlayer);
-        	playerListChanged = true;
+            if (!shared || sharedLedger.admits(newPlrName))
+            {
+                addPlayer(newPlrName);
+                playerListChanged = true;
+            }
 
 			std::cout << '\n';
             break;
@@ -36,16 +261,17 @@ int main()
 
         case 2: // Remove player
         {
-            std::cout << "Enter the name of the player to remove: ";
+            TRACE_SPAN("menu 2: remove player");
+            std::cout << "Enter the name of the player to remove (Tab completes): ";
             std::string plrToDel = getStringInput(REMOVE_PLAYER);
 
             if (playerList.size() == 2)
             { // must account for NONE player at index 0, hence the 2
-                std::cerr << "ERROR: Must be at least one player!" << '\n';
+                logEvent(EVENT_MUST_KEEP_ONE_PLAYER);
             }
             else
             {
-                playerList.erase(playerList.begin() + getPlayerIndex(plrToDel));
+                removePlayer(plrToDel);
                 playerListChanged = true;
             }
 
@@ -55,7 +281,8 @@ int main()
 
         case 3: // Enter player chip amounts
         {
-            std::cout << "Enter the name of the player to edit: ";
+            TRACE_SPAN("menu 3: enter chips");
+            std::cout << "Enter the name of the player to edit (Tab completes): ";
             std::string plrToEdit = getStringInput(EDIT_PLAYER_CHIPS);
 
             if (playerExists(plrToEdit))
@@ -87,8 +314,10 @@ int main()
                     }
                 }
 
+                player.chipsEntered = true;
                 std::cout << '\n';
                 printChipAmounts(player);
+                sessionChanged = true;
             }
 
 			std::cout << '\n';
@@ -97,39 +326,67 @@ int main()
 
         case 4: // Display player winnings
         {
-            float totalWinnings = 0.0f;
+            TRACE_SPAN("menu 4: print winnings");
+            std::cout << "Choose a winnings report." << '\n';
+            std::cout << "1. All players - Every player in roster order." << '\n';
+            std::cout << "2. Top - The biggest winners and losers." << '\n';
+            std::cout << "3. Percentiles - Winnings at common percentile cut-offs." << '\n';
+
+            int reportChoice = getIntegerInput(WINNINGS_REPORT);
+            std::cout << '\n';
+
+            if (reportChoice == 2)
+            {
+                std::cout << "Enter the number of players to show: ";
+                int reportCount = getIntegerInput(REPORT_COUNT);
+                std::cout << '\n';
+
+                printTopWinnings(reportCount);
+            }
+            else if (reportChoice == 3)
+            {
+                printWinningsPercentiles();
+            }
+
+            long long totalCents = 0;
 
             for (int i = 1; i < playerList.size(); i++)
             {
-                Player player = playerList[i];
+                const Player& player = playerList[i];
                 float playerWinnings = calculateWinnings(player);
-                std::cout << player.name << ": $" << playerWinnings << '\n';
+                totalCents += calculateWinningsCents(player);
+
+                if (reportChoice != 1)
+                {
+                    continue;
+                }
 
-                totalWinnings += playerWinnings;
+                std::cout << player.name << ": $" << playerWinnings;
+
+                if (getSessionStore().sessionsPlayed(player.name) > 0)
+                {
+                    std::cout << " (lifetime $" << getSessionStore().lifetimeCents(player.name) / 100.0 << ")";
+                }
+                std::cout << '\n';
             }
 
 			std::cout << '\n';
 
-            if (potAmount == 0)
+            long long potCents = getPotCents();
+            if (potCents == 0)
             {
-                std::cerr << "WARNING: No pot amount is currently set." << '\n';
+                logEvent(EVENT_NO_POT_SET);
             }
-            else if (potAmount < totalWinnings)
+            else if (potCents < totalCents)
             {
-                float difference = totalWinnings - potAmount;
-                std::cerr << "WARNING: Total winnings exceed the pot amount by $"
-                    << difference << "! Ensure chips haven't been overcounted."
-                    << '\n';
+                logEvent(EVENT_WINNINGS_EXCEED_POT, EventDollars{ totalCents - potCents });
             }
-            else if (potAmount > totalWinnings)
+            else if (potCents > totalCents)
             {
-                float difference = potAmount - totalWinnings;
-                std::cerr << "WARNING: Total winnings are less than the pot amount by $"
-                    << difference << "! Ensure chips haven't been undercounted."
-                    << '\n';
+                logEvent(EVENT_WINNINGS_BELOW_POT, EventDollars{ potCents - totalCents });
             }
 
-            std::cout << "Total pot amount: $" << potAmount << '\n';
+            std::cout << "Total pot amount: $" << potCents / 100.0 << '\n';
 
 			std::cout << '\n';
             break;
@@ -137,6 +394,7 @@ int main()
 
         case 5: // Set pot amount
         {
+            TRACE_SPAN("menu 5: set pot");
             std::cout << "Choose an option for setting the pot." << '\n';
             std::cout << "1. Default - Multiplies the number of players by 10.25." << '\n';
             std::cout << "2. Custom - Specify a custom amount." << '\n';
@@ -147,7 +405,7 @@ int main()
             {
             case 1:
             {
-                potAmount = (playerList.size() - 1) * 10.25f;
+                setPotCents((playerList.size() - 1) * DEFAULT_POT_CENTS_PER_PLAYER);
 
                 break;    
             }
@@ -155,48 +413,129 @@ int main()
             case 2:
             {
                 std::cout << "Enter the desired pot amount (xx.xx): ";
-                std::cin >> potAmount;
-
-                while (std::cin.fail() || potAmount < 0)
-                {
-                    std::cin.clear();
-                    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                    std::cerr << "ERROR: Please enter a valid pot amount: ";
-                    std::cin >> potAmount;
-                }
+                setPotCents(std::llround(getFloatInput(POT_AMOUNT) * 100.0f));
 
                 break;
             }
             }
 
-            std::cout << "Pot set to $" << potAmount << '\n';
+            std::cout << "Pot set to $" << getPotCents() / 100.0 << '\n';
+            sessionChanged = true;
         	std::cout << '\n';	
             break;
         }
 
         case 6: // Terminate program
         {
+            TRACE_SPAN("menu 6: exit");
             exit = true;
 
+#ifdef POKERPAL_INSTRUMENTATION
+            printLookupInstrumentation();
+#endif
+
+            if (sessionChanged && getSessionStore().recordSession(getTodaysDate(), getPotCents()))
+            {
+                std::cout << "Saved session " << getSessionStore().sessionCount() << " to '" << SESSION_STORE_DIRECTORY << "'." << '\n';
+            }
+
             if (playerListChanged)
             {
-                std::ofstream outFile("players.txt");
+                savePlayerList();
+            }
 
-                for (int i = 1; i < playerList.size(); i++)
-                {
-                    if (i == 1)
-                    {
-                        outFile << playerList[i].name;
-                    }
-                    else
-                    {
-                        outFile << '\n' << playerList[i].name;
-                    }
-                }
+            break;
+        }
+
+        case 7: // Push/fold chart
+        {
+            TRACE_SPAN("menu 7: push/fold chart");
+            runPushFoldSolver();
+
+            std::cout << '\n';
+            break;
+        }
+
+        case 8: // Simulate hands
+        {
+            TRACE_SPAN("menu 8: simulate hands");
+            std::cout << "Enter the number of hands to play at each table: ";
+            int handsPerTable = getIntegerInput(SIMULATION_HANDS);
+
+            runSimulation(handsPerTable, std::chrono::steady_clock::now().time_since_epoch().count());
+            sessionChanged = true;
+
+            std::cout << '\n';
+            break;
+        }
+
+        case 9: // Import hand history
+        {
+            TRACE_SPAN("menu 9: import history");
+            std::cout << "Enter the hand history file to import: ";
+            std::string historyPath;
+            std::cin >> historyPath;
+
+            size_t playersBefore = playerList.size();
+            auto start = std::chrono::steady_clock::now();
+            IngestionSummary summary = ingestHandHistoryFiles({ historyPath });
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            printIngestionSummary(summary, elapsed.count());
+            printIngestionNets(summary);
+            playerListChanged |= playerList.size() != playersBefore;
+
+            if (summary.handCount > 0 && convertHandHistoryFile(historyPath, historyPath + BINARY_HISTORY_EXTENSION))
+            {
+                std::cout << "Saved binary history to " << historyPath + BINARY_HISTORY_EXTENSION << '\n';
+            }
+
+            std::cout << '\n';
+            break;
+        }
+
+        case 10: // Player statistics
+        {
+            TRACE_SPAN("menu 10: player statistics");
+            std::cout << "Enter the binary hand history (" << BINARY_HISTORY_EXTENSION << ") to analyse: ";
+            std::string historyPath;
+            std::cin >> historyPath;
+
+            runPlayerStatsReport({ historyPath });
+
+            std::cout << '\n';
+            break;
+        }
+
+        case 11: // Season leaderboard
+        {
+            TRACE_SPAN("menu 11: leaderboard");
+            printLeaderboard(LEADERBOARD_TOP_COUNT);
+
+            std::cout << '\n';
+            break;
+        }
+
+        case 12: // Bulk chip entry
+        {
+            TRACE_SPAN("menu 12: bulk chip entry");
+            if (runBulkChipEntry() > 0)
+            {
+                sessionChanged = true;
             }
 
+            std::cout << '\n';
             break;
         }
         }
+
+        if (shared)
+        {
+            sharedSync.push();
+        }
+        if (replicated)
+        {
+            replicaSync.push();
+        }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,271 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sorted index of player names for prefix queries. Most names sit in a packed
+// base array (one character buffer plus offsets). Adds and removes go into
+// small sorted side lists that are folded into the base once they grow past
+// a fraction of it, so edits never rebuild the index one at a time.
+class NameIndex
+{
+public:
+    void build(std::vector<std::string> names)
+    {
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+
+        baseCharacters.clear();
+        baseOffsets.assign(1, 0);
+        for (const std::string& name : names)
+        {
+            baseCharacters += name;
+            baseOffsets.push_back(static_cast<uint32_t>(baseCharacters.size()));
+        }
+
+        added.clear();
+        removed.clear();
+    }
+
+    size_t size() const { return baseOffsets.size() - 1 - removed.size() + added.size(); }
+
+    bool contains(std::string_view name) const
+    {
+        return baseContains(name) ? !isRemoved(name)
+            : std::binary_search(added.begin(), added.end(), name, [](std::string_view a, std::string_view b) { return a < b; });
+    }
+
+    void insert(const std::string& name)
+    {
+        if (eraseSorted(removed, name) || baseContains(name))
+        {
+            return;
+        }
+
+        insertSorted(added, name);
+        compactIfNeeded();
+    }
+
+    void erase(const std::string& name)
+    {
+        if (eraseSorted(added, name) || !baseContains(name))
+        {
+            return;
+        }
+
+        insertSorted(removed, name);
+        compactIfNeeded();
+    }
+
+    // Calls visit(name) for every name starting with prefix, in sorted order,
+    // until it returns false.
+    template <typename Visitor>
+    void forEachWithPrefix(std::string_view prefix, Visitor&& visit) const
+    {
+        size_t base = baseLowerBound(prefix);
+        auto extra = std::lower_bound(added.begin(), added.end(), prefix,
+            [](const std::string& name, std::string_view value) { return std::string_view(name) < value; });
+
+        for (;;)
+        {
+            while (base < baseCount() && baseStartsWith(base, prefix) && isRemoved(baseName(base)))
+            {
+                base++;
+            }
+
+            bool baseMatches = base < baseCount() && baseStartsWith(base, prefix);
+            bool extraMatches = extra != added.end() && std::string_view(*extra).substr(0, prefix.size()) == prefix;
+
+            if (!baseMatches && !extraMatches)
+            {
+                return;
+            }
+
+            std::string_view next;
+            if (extraMatches && (!baseMatches || std::string_view(*extra) < baseName(base)))
+            {
+                next = *extra++;
+            }
+            else
+            {
+                next = baseName(base++);
+            }
+
+            if (!visit(next))
+            {
+                return;
+            }
+        }
+    }
+
+    // Up to `limit` names starting with prefix.
+    std::vector<std::string> complete(std::string_view prefix, size_t limit) const
+    {
+        std::vector<std::string> matches;
+        forEachWithPrefix(prefix, [&](std::string_view name)
+        {
+            matches.emplace_back(name);
+            return matches.size() < limit;
+        });
+
+        return matches;
+    }
+
+    // The longest prefix shared by every name starting with prefix, which is
+    // the common prefix of the first and last of them in sorted order.
+    std::string commonPrefix(std::string_view prefix) const
+    {
+        std::string first;
+        forEachWithPrefix(prefix, [&](std::string_view name)
+        {
+            first = name;
+            return false;
+        });
+
+        if (first.empty())
+        {
+            return std::string(prefix);
+        }
+
+        std::string_view last = first;
+        size_t base = baseLowerBound(prefix);
+        size_t baseEnd = basePrefixEnd(prefix);
+        while (baseEnd > base && isRemoved(baseName(baseEnd - 1)))
+        {
+            baseEnd--;
+        }
+        if (baseEnd > base)
+        {
+            last = std::max(last, baseName(baseEnd - 1));
+        }
+
+        auto addedEnd = std::partition_point(added.begin(), added.end(),
+            [&](const std::string& name) { return std::string_view(name).substr(0, prefix.size()) <= prefix; });
+        if (addedEnd != added.begin() && std::string_view(*(addedEnd - 1)).substr(0, prefix.size()) == prefix)
+        {
+            last = std::max(last, std::string_view(*(addedEnd - 1)));
+        }
+
+        size_t length = 0;
+        while (length < first.size() && length < last.size() && first[length] == last[length])
+        {
+            length++;
+        }
+
+        return first.substr(0, length);
+    }
+
+private:
+    size_t baseCount() const { return baseOffsets.size() - 1; }
+
+    std::string_view baseName(size_t index) const
+    {
+        return std::string_view(baseCharacters).substr(baseOffsets[index], baseOffsets[index + 1] - baseOffsets[index]);
+    }
+
+    bool baseStartsWith(size_t index, std::string_view prefix) const
+    {
+        return baseName(index).substr(0, prefix.size()) == prefix;
+    }
+
+    size_t baseLowerBound(std::string_view value) const
+    {
+        size_t low = 0;
+        size_t high = baseCount();
+
+        while (low < high)
+        {
+            size_t middle = (low + high) / 2;
+            if (baseName(middle) < value)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        return low;
+    }
+
+    // One past the last base name starting with prefix.
+    size_t basePrefixEnd(std::string_view prefix) const
+    {
+        size_t low = 0;
+        size_t high = baseCount();
+
+        while (low < high)
+        {
+            size_t middle = (low + high) / 2;
+            if (baseName(middle).substr(0, prefix.size()) <= prefix)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        return low;
+    }
+
+    bool baseContains(std::string_view name) const
+    {
+        size_t index = baseLowerBound(name);
+        return index < baseCount() && baseName(index) == name;
+    }
+
+    bool isRemoved(std::string_view name) const
+    {
+        return std::binary_search(removed.begin(), removed.end(), name,
+            [](std::string_view a, std::string_view b) { return a < b; });
+    }
+
+    static void insertSorted(std::vector<std::string>& names, const std::string& name)
+    {
+        auto position = std::lower_bound(names.begin(), names.end(), name);
+        if (position == names.end() || *position != name)
+        {
+            names.insert(position, name);
+        }
+    }
+
+    static bool eraseSorted(std::vector<std::string>& names, const std::string& name)
+    {
+        auto position = std::lower_bound(names.begin(), names.end(), name);
+        if (position == names.end() || *position != name)
+        {
+            return false;
+        }
+
+        names.erase(position);
+        return true;
+    }
+
+    void compactIfNeeded()
+    {
+        if (added.size() + removed.size() <= std::max<size_t>(64, baseCount() / 32))
+        {
+            return;
+        }
+
+        std::vector<std::string> names;
+        names.reserve(size());
+        forEachWithPrefix("", [&](std::string_view name)
+        {
+            names.emplace_back(name);
+            return true;
+        });
+
+        build(std::move(names));
+    }
+
+    std::string baseCharacters;
+    std::vector<uint32_t> baseOffsets = { 0 };
+    std::vector<std::string> added;   // sorted, not in the base
+    std::vector<std::string> removed; // sorted, still in the base
+};
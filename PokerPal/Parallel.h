@@ -0,0 +1,162 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline unsigned getWorkerCount()
+{
+    unsigned hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads == 0 ? 1 : hardwareThreads;
+}
+
+// Runs function(i) for every i in [0, count) across the available cores.
+// Indices are handed out one at a time, so uneven work items still balance.
+template <typename Function>
+void parallelFor(size_t count, Function function)
+{
+    size_t workerCount = std::min<size_t>(getWorkerCount(), count);
+
+    if (workerCount <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            function(i);
+        }
+
+        return;
+    }
+
+    std::atomic<size_t> nextIndex(0);
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+
+    for (size_t w = 0; w < workerCount; w++)
+    {
+        workers.emplace_back([&]()
+        {
+            for (size_t i = nextIndex++; i < count; i = nextIndex++)
+            {
+                function(i);
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Threads kept between parallel loops, for callers that run many short loops
+// in a row, where starting threads for each one would cost more than the
+// work. The calling thread takes indices too. A pool runs one loop at a time
+// and must not be used from inside its own loop.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned threadCount = getWorkerCount())
+    {
+        for (unsigned t = 1; t < threadCount; t++)
+        {
+            workers.emplace_back([this]() { work(); });
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Runs function(i) for every i in [0, count), like parallelFor.
+    template <typename Function>
+    void parallelFor(size_t count, Function function)
+    {
+        if (workers.empty() || count <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                function(i);
+            }
+
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        job = [&function](size_t i) { function(i); };
+        jobCount = count;
+        nextIndex = 0;
+        busyWorkers = workers.size();
+        generation++;
+        lock.unlock();
+        wake.notify_all();
+
+        runJob();
+
+        lock.lock();
+        finished.wait(lock, [this]() { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+private:
+    void work()
+    {
+        uint64_t seenGeneration = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+
+        for (;;)
+        {
+            wake.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping)
+            {
+                return;
+            }
+
+            seenGeneration = generation;
+            lock.unlock();
+            runJob();
+            lock.lock();
+
+            if (--busyWorkers == 0)
+            {
+                finished.notify_one();
+            }
+        }
+    }
+
+    void runJob()
+    {
+        for (size_t i = nextIndex++; i < jobCount; i = nextIndex++)
+        {
+            job(i);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::function<void(size_t)> job;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextIndex{ 0 };
+    size_t busyWorkers = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
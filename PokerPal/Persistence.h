@@ -0,0 +1,604 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Parallel.h"
+#include "Tracing.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+constexpr size_t PERSIST_BUFFER_SIZE = 1 << 20; // bytes per registered buffer, and per pwrite
+constexpr unsigned PERSIST_BUFFER_COUNT = 8;
+constexpr unsigned PERSIST_RING_ENTRIES = 16;
+
+enum FileWriteMode { REPLACE_FILE, APPEND_FILE, WRITE_FILE_AT };
+
+// One file's worth of bytes for the persistence queue. REPLACE_FILE writes a
+// temporary file and renames it over the old one once it is synced, so
+// readers only ever see a complete file; APPEND_FILE adds to the end;
+// WRITE_FILE_AT cuts the file back to offset and writes from there.
+struct FileWrite
+{
+    std::string path;
+    FileWriteMode mode = REPLACE_FILE;
+    uint64_t offset = 0;
+    std::vector<std::vector<uint8_t>> parts;
+
+    void add(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        if (parts.empty() || parts.back().size() >= PERSIST_BUFFER_SIZE)
+        {
+            parts.emplace_back();
+        }
+
+        parts.back().insert(parts.back().end(), bytes, bytes + size);
+    }
+
+    void add(std::string_view text)
+    {
+        add(text.data(), text.size());
+    }
+
+    // Takes a large buffer without copying it.
+    void adopt(std::vector<uint8_t>&& bytes)
+    {
+        parts.push_back(std::move(bytes));
+    }
+
+    uint64_t size() const
+    {
+        uint64_t total = 0;
+        for (const std::vector<uint8_t>& part : parts)
+        {
+            total += part.size();
+        }
+
+        return total;
+    }
+
+    // Rewrites bytes already added, such as a header whose fields are only
+    // known at the end.
+    void overwrite(uint64_t position, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (std::vector<uint8_t>& part : parts)
+        {
+            while (size > 0 && position < part.size())
+            {
+                part[position++] = *bytes++;
+                size--;
+            }
+            position -= std::min<uint64_t>(position, part.size());
+        }
+    }
+};
+
+#ifdef __linux__
+// Writes through io_uring from a fixed set of registered buffers, so the
+// kernel never has to pin pages per write. A file's last write is linked to
+// its fsync, which only runs once every write before it has completed.
+class UringFileWriter
+{
+public:
+    UringFileWriter() = default;
+    UringFileWriter(const UringFileWriter&) = delete;
+    UringFileWriter& operator=(const UringFileWriter&) = delete;
+
+    ~UringFileWriter()
+    {
+        close();
+    }
+
+    bool open()
+    {
+        io_uring_params params = {};
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, PERSIST_RING_ENTRIES, &params));
+        if (ringFd < 0)
+        {
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap)
+        {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        cqRing = singleMap ? sqRing
+            : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        sqeCount = params.sq_entries;
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqeCount * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+        if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        buffers.resize(PERSIST_BUFFER_COUNT * PERSIST_BUFFER_SIZE);
+        iovec vectors[PERSIST_BUFFER_COUNT];
+        for (unsigned b = 0; b < PERSIST_BUFFER_COUNT; b++)
+        {
+            vectors[b] = { buffers.data() + b * PERSIST_BUFFER_SIZE, PERSIST_BUFFER_SIZE };
+            freeBuffers.push_back(b);
+        }
+
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, vectors, PERSIST_BUFFER_COUNT) < 0)
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // Writes parts back to back from offset, then syncs the file.
+    bool write(int fd, uint64_t offset, const std::vector<std::vector<uint8_t>>& parts)
+    {
+        failed = false;
+        size_t part = 0;
+        size_t partOffset = 0;
+        bool done = false;
+
+        while (!done && ringUsable)
+        {
+            if (freeBuffers.empty())
+            {
+                submit(1);
+                continue;
+            }
+
+            unsigned buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+
+            size_t length = 0;
+            uint8_t* start = buffers.data() + buffer * PERSIST_BUFFER_SIZE;
+            while (part < parts.size() && length < PERSIST_BUFFER_SIZE)
+            {
+                size_t taken = std::min(PERSIST_BUFFER_SIZE - length, parts[part].size() - partOffset);
+                std::memcpy(start + length, parts[part].data() + partOffset, taken);
+                length += taken;
+                partOffset += taken;
+                if (partOffset == parts[part].size())
+                {
+                    part++;
+                    partOffset = 0;
+                }
+            }
+            done = part == parts.size();
+
+            if (done)
+            {
+                // The fsync may only follow writes that have finished.
+                while (inFlight > 0)
+                {
+                    submit(1);
+                }
+            }
+
+            if (length > 0)
+            {
+                io_uring_sqe* sqe = nextSqe();
+                sqe->opcode = IORING_OP_WRITE_FIXED;
+                sqe->fd = fd;
+                sqe->addr = reinterpret_cast<uint64_t>(start);
+                sqe->len = static_cast<uint32_t>(length);
+                sqe->off = offset;
+                sqe->buf_index = static_cast<uint16_t>(buffer);
+                sqe->flags = done ? IOSQE_IO_LINK : 0;
+                sqe->user_data = buffer;
+                expectedLengths[buffer] = length;
+                offset += length;
+                inFlight++;
+            }
+            else
+            {
+                freeBuffers.push_back(buffer);
+            }
+
+            if (done)
+            {
+                io_uring_sqe* sqe = nextSqe();
+                sqe->opcode = IORING_OP_FSYNC;
+                sqe->fd = fd;
+                sqe->user_data = FSYNC_TAG;
+                inFlight++;
+            }
+
+            submit(0);
+        }
+
+        while (inFlight > 0)
+        {
+            submit(1);
+        }
+
+        return !failed && ringUsable;
+    }
+
+    // False once the kernel has refused the ring; nothing more can go through it.
+    bool usable() const { return ringUsable; }
+
+private:
+    static constexpr uint64_t FSYNC_TAG = UINT64_MAX;
+
+    io_uring_sqe* nextSqe()
+    {
+        unsigned index = pendingTail & sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        pendingTail++;
+        pendingCount++;
+
+        return sqe;
+    }
+
+    // Hands queued entries to the kernel, waits for at least minComplete
+    // completions, and reaps whatever has completed.
+    void submit(unsigned minComplete)
+    {
+        __atomic_store_n(sqTail, pendingTail, __ATOMIC_RELEASE);
+
+        unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+        while (syscall(__NR_io_uring_enter, ringFd, pendingCount, minComplete, flags, nullptr, 0) < 0)
+        {
+            if (errno != EINTR)
+            {
+                failed = true;
+                ringUsable = false;
+                inFlight = 0;
+                return;
+            }
+        }
+        pendingCount = 0;
+
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            const io_uring_cqe& cqe = cqes[head & cqMask];
+            if (cqe.user_data == FSYNC_TAG)
+            {
+                failed |= cqe.res < 0;
+            }
+            else
+            {
+                failed |= cqe.res < 0 || static_cast<size_t>(cqe.res) != expectedLengths[cqe.user_data];
+                freeBuffers.push_back(static_cast<unsigned>(cqe.user_data));
+            }
+            inFlight--;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    void close()
+    {
+        if (sqes != nullptr && sqes != MAP_FAILED)
+        {
+            munmap(sqes, sqeCount * sizeof(io_uring_sqe));
+        }
+        if (cqRing != nullptr && cqRing != MAP_FAILED && cqRing != sqRing)
+        {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != nullptr && sqRing != MAP_FAILED)
+        {
+            munmap(sqRing, sqRingSize);
+        }
+        if (ringFd >= 0)
+        {
+            ::close(ringFd);
+        }
+
+        ringFd = -1;
+        sqRing = cqRing = nullptr;
+        sqes = nullptr;
+    }
+
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    unsigned sqeCount = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    unsigned pendingTail = 0;
+    unsigned pendingCount = 0;
+    unsigned inFlight = 0;
+    bool failed = false;
+    bool ringUsable = true;
+    std::vector<uint8_t> buffers;
+    std::vector<unsigned> freeBuffers;
+    size_t expectedLengths[PERSIST_BUFFER_COUNT] = {};
+};
+#endif
+
+#ifndef _WIN32
+// Where io_uring is unavailable: the parts are cut into buffer-sized pieces
+// and written with pwrite across the worker threads, then synced.
+inline bool pwriteParts(int fd, uint64_t offset, const std::vector<std::vector<uint8_t>>& parts)
+{
+    struct Piece
+    {
+        const uint8_t* data;
+        size_t size;
+        uint64_t offset;
+    };
+
+    std::vector<Piece> pieces;
+    for (const std::vector<uint8_t>& part : parts)
+    {
+        for (size_t start = 0; start < part.size(); start += PERSIST_BUFFER_SIZE)
+        {
+            size_t size = std::min(PERSIST_BUFFER_SIZE, part.size() - start);
+            pieces.push_back({ part.data() + start, size, offset });
+            offset += size;
+        }
+    }
+
+    std::atomic<bool> written(true);
+    parallelFor(pieces.size(), [&](size_t p)
+    {
+        Piece piece = pieces[p];
+        while (piece.size > 0)
+        {
+            ssize_t count = pwrite(fd, piece.data, piece.size, static_cast<off_t>(piece.offset));
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                written = false;
+                return;
+            }
+
+            piece.data += count;
+            piece.size -= count;
+            piece.offset += count;
+        }
+    });
+
+    return written && fsync(fd) == 0;
+}
+#endif
+
+// Every file PokerPal writes goes through this queue. submit() only moves the
+// bytes onto the queue, so the menu never waits for the disk; one background
+// thread writes each file in turn, in submission order, and reports failures
+// itself. flush() and waitFor() are for the few places that read back what
+// they wrote. Anything still queued at exit is written before the process
+// ends.
+class PersistenceQueue
+{
+public:
+    PersistenceQueue() = default;
+    PersistenceQueue(const PersistenceQueue&) = delete;
+    PersistenceQueue& operator=(const PersistenceQueue&) = delete;
+
+    ~PersistenceQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queued.notify_all();
+
+        if (writer.joinable())
+        {
+            writer.join();
+        }
+    }
+
+    void submit(FileWrite&& write)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pendingPaths[write.path]++;
+            writes.push_back(std::move(write));
+
+            if (!writer.joinable())
+            {
+                writer = std::thread([this]() { run(); });
+            }
+        }
+
+        queued.notify_one();
+    }
+
+    // Waits until everything submitted so far is on disk. Returns false if
+    // any write failed since the last flush.
+    bool flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        written.wait(lock, [&]() { return pendingPaths.empty(); });
+
+        return !std::exchange(writeFailed, false);
+    }
+
+    // Waits until every write submitted so far for one path is on disk.
+    void waitFor(const std::string& path)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        written.wait(lock, [&]() { return pendingPaths.count(path) == 0; });
+    }
+
+private:
+    void run()
+    {
+#ifdef __linux__
+        uringAvailable = uring.open();
+#endif
+
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            queued.wait(lock, [&]() { return stopping || !writes.empty(); });
+            if (writes.empty())
+            {
+                return;
+            }
+
+            FileWrite write = std::move(writes.front());
+            writes.pop_front();
+            lock.unlock();
+
+            bool saved = writeFile(write);
+            if (!saved)
+            {
+                std::cerr << "ERROR: Unable to write '" << write.path << "'!" << '\n';
+            }
+
+            lock.lock();
+            writeFailed |= !saved;
+            if (--pendingPaths[write.path] == 0)
+            {
+                pendingPaths.erase(write.path);
+            }
+            written.notify_all();
+        }
+    }
+
+#ifdef _WIN32
+    bool writeFile(const FileWrite& write)
+    {
+        TRACE_SPAN("writeFile");
+        std::string target = write.mode == REPLACE_FILE ? write.path + ".tmp" : write.path;
+        std::error_code error;
+        if (write.mode == WRITE_FILE_AT && std::filesystem::exists(target, error)
+            && std::filesystem::file_size(target, error) != write.offset)
+        {
+            std::filesystem::resize_file(target, write.offset, error);
+        }
+
+        {
+            std::ofstream file(target, std::ios::binary | (write.mode == REPLACE_FILE ? std::ios::trunc : std::ios::app));
+            for (const std::vector<uint8_t>& part : write.parts)
+            {
+                file.write(reinterpret_cast<const char*>(part.data()), part.size());
+            }
+            if (!file.flush())
+            {
+                return false;
+            }
+        }
+
+        if (write.mode == REPLACE_FILE)
+        {
+            std::filesystem::rename(target, write.path, error);
+        }
+
+        return !error;
+    }
+#else
+    bool writeFile(const FileWrite& write)
+    {
+        TRACE_SPAN("writeFile");
+        std::string target = write.mode == REPLACE_FILE ? write.path + ".tmp" : write.path;
+        int fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (write.mode == REPLACE_FILE ? O_TRUNC : 0), 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat status;
+        uint64_t offset = write.mode == WRITE_FILE_AT ? write.offset : 0;
+        bool positioned = fstat(fd, &status) == 0;
+        if (positioned && write.mode == APPEND_FILE)
+        {
+            offset = status.st_size;
+        }
+        else if (positioned && write.mode == WRITE_FILE_AT && static_cast<uint64_t>(status.st_size) != offset)
+        {
+            positioned = ftruncate(fd, static_cast<off_t>(offset)) == 0;
+        }
+
+        bool synced = false;
+#ifdef __linux__
+        if (positioned && uringAvailable)
+        {
+            synced = uring.write(fd, offset, write.parts);
+            uringAvailable = uring.usable(); // a ring the kernel refuses falls back to pwrite from here on
+        }
+        if (positioned && !uringAvailable)
+#else
+        if (positioned)
+#endif
+        {
+            synced = pwriteParts(fd, offset, write.parts);
+        }
+        ::close(fd);
+
+        return synced && (write.mode != REPLACE_FILE || std::rename(target.c_str(), write.path.c_str()) == 0);
+    }
+#endif
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable written;
+    std::deque<FileWrite> writes;
+    std::unordered_map<std::string, size_t> pendingPaths; // submitted and not yet on disk
+    bool writeFailed = false;
+    bool stopping = false;
+    std::thread writer;
+
+#ifdef __linux__
+    UringFileWriter uring;
+    bool uringAvailable = false;
+#endif
+};
+
+inline PersistenceQueue& getPersistenceQueue()
+{
+    static PersistenceQueue queue;
+    return queue;
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "BinaryHistory.h"
+#include "Parallel.h"
+#include "PokerPal.h"
+#include "Tracing.h"
+
+struct PlayerStats
+{
+    long long hands = 0;
+    long long vpipHands = 0;         // put chips in preflop voluntarily
+    long long pfrHands = 0;          // bet or raised preflop
+    long long aggressiveActions = 0; // bets and raises on any street
+    long long passiveActions = 0;    // calls on any street
+    long long netCents = 0;
+
+    void merge(const PlayerStats& other)
+    {
+        hands += other.hands;
+        vpipHands += other.vpipHands;
+        pfrHands += other.pfrHands;
+        aggressiveActions += other.aggressiveActions;
+        passiveActions += other.passiveActions;
+        netCents += other.netCents;
+    }
+
+    double vpip() const { return hands == 0 ? 0.0 : 100.0 * vpipHands / hands; }
+    double pfr() const { return hands == 0 ? 0.0 : 100.0 * pfrHands / hands; }
+    double aggressionFactor() const { return passiveActions == 0 ? 0.0 : static_cast<double>(aggressiveActions) / passiveActions; }
+};
+
+// Adds one hand to the stats of its players. Stats are indexed by the file's
+// dictionary ids, so the hot loop never touches a name.
+inline void accumulateHandStats(const ParsedHand& hand, const std::array<uint32_t, MAX_HISTORY_SEATS>& seatPlayerIds,
+    std::vector<PlayerStats>& stats)
+{
+    size_t preflopActions = hand.boardCount > 0 ? hand.boardActionIndex[0] : hand.actions.size();
+    uint32_t vpipSeats = 0;
+    uint32_t pfrSeats = 0;
+
+    for (size_t a = 0; a < hand.actions.size(); a++)
+    {
+        const HandAction& action = hand.actions[a];
+        uint32_t seatBit = 1u << action.seat;
+        bool preflop = a < preflopActions;
+
+        switch (action.type)
+        {
+        case CALLS:
+            stats[seatPlayerIds[action.seat]].passiveActions++;
+            vpipSeats |= preflop ? seatBit : 0;
+            break;
+        case BETS:
+        case RAISES:
+            stats[seatPlayerIds[action.seat]].aggressiveActions++;
+            vpipSeats |= preflop ? seatBit : 0;
+            pfrSeats |= preflop ? seatBit : 0;
+            break;
+        default:
+            break;
+        }
+    }
+
+    std::array<long long, MAX_HISTORY_SEATS> net = hand.netResults();
+    for (int seat = 0; seat < hand.seatCount; seat++)
+    {
+        PlayerStats& player = stats[seatPlayerIds[seat]];
+        player.hands++;
+        player.vpipHands += (vpipSeats >> seat) & 1;
+        player.pfrHands += (pfrSeats >> seat) & 1;
+        player.netCents += net[seat];
+    }
+}
+
+// Splits the block index into one contiguous range per worker. Each worker
+// fills its own dense table, and the tables are summed at the end.
+inline std::vector<PlayerStats> computePlayerStats(const BinaryHistory& history)
+{
+    size_t blockCount = history.blockCount();
+    size_t rangeCount = std::max<size_t>(1, std::min<size_t>(getWorkerCount(), blockCount));
+    std::vector<std::vector<PlayerStats>> partialStats(rangeCount, std::vector<PlayerStats>(history.playerCount()));
+
+    parallelFor(rangeCount, [&](size_t r)
+    {
+        std::vector<PlayerStats>& stats = partialStats[r];
+
+        for (size_t block = blockCount * r / rangeCount; block < blockCount * (r + 1) / rangeCount; block++)
+        {
+            history.forEachHandInBlock(block, [&](const ParsedHand& hand, const std::array<uint32_t, MAX_HISTORY_SEATS>& seatPlayerIds)
+            {
+                accumulateHandStats(hand, seatPlayerIds, stats);
+                return true;
+            });
+        }
+    });
+
+    for (size_t r = 1; r < rangeCount; r++)
+    {
+        for (size_t id = 0; id < partialStats[0].size(); id++)
+        {
+            partialStats[0][id].merge(partialStats[r][id]);
+        }
+    }
+
+    return std::move(partialStats[0]);
+}
+
+// Prints stats for every roster player across the given .pph files.
+inline void runPlayerStatsReport(const std::vector<std::string>& paths)
+{
+    TRACE_SPAN("runPlayerStatsReport");
+    auto start = std::chrono::steady_clock::now();
+
+    std::unordered_map<std::string_view, int> rosterIndexes;
+    for (int i = 1; i < playerList.size(); i++)
+    {
+        rosterIndexes[playerList[i].name] = i;
+    }
+
+    std::vector<PlayerStats> rosterStats(playerList.size());
+    long long handCount = 0;
+    long long unknownPlayers = 0;
+
+    for (const std::string& path : paths)
+    {
+        BinaryHistory history;
+        if (!history.open(path))
+        {
+            std::cerr << "ERROR: '" << path << "' is not a binary hand history!" << '\n';
+            continue;
+        }
+
+        std::vector<PlayerStats> fileStats = computePlayerStats(history);
+        handCount += history.handCount();
+
+        for (uint32_t id = 0; id < fileStats.size(); id++)
+        {
+            auto roster = rosterIndexes.find(history.playerName(id));
+            if (roster == rosterIndexes.end())
+            {
+                unknownPlayers++;
+                continue;
+            }
+
+            rosterStats[roster->second].merge(fileStats[id]);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::left << std::setw(16) << "Player" << std::right << std::setw(10) << "Hands" << std::setw(8) << "VPIP"
+        << std::setw(8) << "PFR" << std::setw(8) << "AF" << std::setw(12) << "Net $" << '\n';
+
+    for (int i = 1; i < playerList.size(); i++)
+    {
+        const PlayerStats& stats = rosterStats[i];
+        std::cout << std::left << std::setw(16) << playerList[i].name << std::right << std::setw(10) << stats.hands
+            << std::setw(7) << stats.vpip() << '%' << std::setw(7) << stats.pfr() << '%' << std::setw(8)
+            << stats.aggressionFactor() << std::setw(12) << stats.netCents / 100.0 << '\n';
+    }
+
+    std::cout << "Scanned " << handCount << " hands in " << elapsed.count() << "s" << '\n';
+    if (unknownPlayers > 0)
+    {
+        std::cerr << "WARNING: " << unknownPlayers << " players in the history are not on the roster." << '\n';
+    }
+}
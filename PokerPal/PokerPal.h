@@ -2,10 +2,23 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "AllocationProfiler.h"
+#include "BloomFilter.h"
+#include "EventLog.h"
+#include "FuzzyIndex.h"
+#include "LineEditor.h"
+#include "NameIndex.h"
+#include "Persistence.h"
+#include "ShardedCounter.h"
+#include "Tracing.h"
+
 constexpr float WHITE_CHIP_VALUE = 0.01f;
 constexpr float RED_CHIP_VALUE   = 0.05f;
 constexpr float BLUE_CHIP_VALUE  = 0.10f;
@@ -14,7 +27,16 @@ constexpr float BLACK_CHIP_VALUE = 1.00f;
 
 const std::string CHIP_COLORS[] = { "white", "red", "blue", "green", "black" };
 
-enum IntInputValidationOptions { MAIN_MENU, ENTER_CHIP_AMOUNTS, SET_POT };
+const std::string PLAYER_LIST_FILE = "players.txt";
+
+constexpr long long DEFAULT_POT_CENTS_PER_PLAYER = 1025; // menu option 5's default buy-in
+
+constexpr int MENU_OPTION_COUNT = 12;
+
+enum IntInputValidationOptions { MAIN_MENU, ENTER_CHIP_AMOUNTS, SET_POT, PAID_PLACES, SIMULATION_HANDS, WINNINGS_REPORT,
+    REPORT_COUNT };
+
+enum FloatInputValidationOptions { POT_AMOUNT, BLIND_AMOUNT, PAYOUT_AMOUNT };
 
 enum StrInputValidationOptions { ADD_PLAYER, REMOVE_PLAYER, EDIT_PLAYER_CHIPS };
 
@@ -26,10 +48,12 @@ struct Player
     int blueChips;
     int greenChips;
     int blackChips;
+    long long netCents; // net result from imported hand histories
+    bool chipsEntered;  // counted tonight, even if every count was zero
 
     Player()
         : name("NONE"), whiteChips(0), redChips(0), blueChips(0), greenChips(0),
-        blackChips(0)
+        blackChips(0), netCents(0), chipsEntered(false)
     {
     }
 };
@@ -37,26 +61,50 @@ struct Player
 std::vector<Player> loadPlayerList();
 std::vector<Player> playerList = loadPlayerList();
 
+// players.txt is edited by hand, so it stays a plain list of names with no
+// checksums: a changed name must load as the new name, not be dropped as
+// corrupt. Every non-empty line is a name.
+template <typename NameHandler>
+void forEachRosterName(std::string_view text, NameHandler onName)
+{
+    size_t begin = 0;
+    while (begin < text.size())
+    {
+        size_t end = std::min(text.find('\n', begin), text.size());
+        std::string_view name = text.substr(begin, end - begin);
+        if (!name.empty() && name.back() == '\r')
+        {
+            name.remove_suffix(1);
+        }
+        if (!name.empty())
+        {
+            onName(name);
+        }
+        begin = end + 1;
+    }
+}
+
 std::vector<Player> loadPlayerList()
 {
-    std::ifstream inFile("players.txt");
+    TRACE_SPAN("loadPlayerList");
+    std::ifstream inFile(PLAYER_LIST_FILE, std::ios::binary);
     std::vector<Player> players;
     players.push_back(Player()); // default player, used for error handling
 
     if (!inFile.is_open())
     {
-        std::cerr << "ERROR: Missing 'players.txt' file!" << '\n';
+        logEvent(EVENT_PLAYER_LIST_MISSING);
     }
     else
     {
-        std::string line;
+        std::string text((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
 
-        while (std::getline(inFile, line))
+        forEachRosterName(text, [&](std::string_view name)
         {
             Player player;
-            player.name = line;
+            player.name = name;
             players.push_back(player);
-        }
+        });
 
         inFile.close();
     }
@@ -64,6 +112,22 @@ std::vector<Player> loadPlayerList()
     return players;
 }
 
+// Queues the roster for writing; the file is replaced once the new one is synced.
+inline void savePlayerList()
+{
+    TRACE_SPAN("savePlayerList");
+    std::string names;
+    for (int i = 1; i < playerList.size(); i++)
+    {
+        names.append(playerList[i].name).append("\n");
+    }
+
+    FileWrite outFile;
+    outFile.path = PLAYER_LIST_FILE;
+    outFile.add(names);
+    getPersistenceQueue().submit(std::move(outFile));
+}
+
 inline float calculateWinnings(const Player& player)
 {
     float winnings = 0;
@@ -76,8 +140,84 @@ inline float calculateWinnings(const Player& player)
     return winnings;
 }
 
+// Exact chip value in cents, for code that must not lose pennies to float
+// rounding.
+inline long long calculateWinningsCents(const Player& player)
+{
+    return player.whiteChips + player.redChips * 5LL + player.blueChips * 10LL + player.greenChips * 25LL
+        + player.blackChips * 100LL;
+}
+
+// The night's pot in cents. Buy-ins recorded from several threads each add
+// to their own shard without contending; readers fold the shards on demand.
+inline ShardedCounter& getPotCounter()
+{
+    static ShardedCounter pot;
+    return pot;
+}
+
+inline long long getPotCents()
+{
+    return getPotCounter().value();
+}
+
+inline void setPotCents(long long cents)
+{
+    getPotCounter().add(cents - getPotCents());
+}
+
+// Replaces a player's chips with the fewest chips worth `cents`.
+inline void setChipsFromCents(Player& player, long long cents)
+{
+    player.blackChips = static_cast<int>(cents / 100);
+    cents %= 100;
+    player.greenChips = static_cast<int>(cents / 25);
+    cents %= 25;
+    player.blueChips = static_cast<int>(cents / 10);
+    cents %= 10;
+    player.redChips = static_cast<int>(cents / 5);
+    player.whiteChips = static_cast<int>(cents % 5);
+    player.chipsEntered = true;
+}
+
+// Typo index over the roster names. Only built on the first failed lookup;
+// addPlayer and removePlayer keep it in step once it exists.
+inline std::unique_ptr<FuzzyNameIndex>& playerFuzzyIndex()
+{
+    static std::unique_ptr<FuzzyNameIndex> index;
+    return index;
+}
+
+// " Did you mean 'x' or 'y'?" for a name that is not on the roster, or "".
+inline std::string suggestPlayerNames(const std::string& name)
+{
+    PROFILE_ALLOCATIONS("suggestPlayerNames");
+    TRACE_SPAN("suggestPlayerNames");
+    std::unique_ptr<FuzzyNameIndex>& index = playerFuzzyIndex();
+    if (!index)
+    {
+        index = std::make_unique<FuzzyNameIndex>();
+        for (int i = 1; i < playerList.size(); i++)
+        {
+            index->insert(playerList[i].name);
+        }
+    }
+
+    std::vector<std::string> suggestions = index->closest(name, MAX_SUGGESTION_DISTANCE, MAX_NAME_SUGGESTIONS);
+    std::string text;
+
+    for (size_t i = 0; i < suggestions.size(); i++)
+    {
+        text += (i == 0 ? " Did you mean '" : i + 1 == suggestions.size() ? " or '" : ", '") + suggestions[i] + "'";
+    }
+
+    return text.empty() ? text : text + "?";
+}
+
 inline Player getPlayer(const std::string& name)
 {
+    PROFILE_ALLOCATIONS("getPlayer");
+    TRACE_SPAN("getPlayer");
     for (int i = 1; i < playerList.size(); i++)
     {
         if (playerList[i].name == name && playerList[i].name != "NONE")
@@ -86,12 +226,14 @@ inline Player getPlayer(const std::string& name)
         }
     }
 
-    std::cerr << "ERROR: Player '" << name << "' not found!" << '\n';
+    logEvent(EVENT_PLAYER_NOT_FOUND, name, suggestPlayerNames(name));
     return playerList[0];
 }
 
 inline int getPlayerIndex(const std::string& name)
 {
+    PROFILE_ALLOCATIONS("getPlayerIndex");
+    TRACE_SPAN("getPlayerIndex");
     for (int i = 1; i < playerList.size(); i++)
     {
         if (playerList[i].name == name && playerList[i].name != "NONE")
@@ -100,12 +242,14 @@ inline int getPlayerIndex(const std::string& name)
         }
     }
 
-    std::cerr << "ERROR: Player '" << name << "' not found!" << '\n';
+    logEvent(EVENT_PLAYER_NOT_FOUND, name, suggestPlayerNames(name));
     return -1;
 }
 
 inline Player& getPlayerReference(const std::string& name)
 {
+    PROFILE_ALLOCATIONS("getPlayerReference");
+    TRACE_SPAN("getPlayerReference");
     for (Player& player : playerList)
     {
         if (player.name == name && player.name != "NONE")
@@ -114,21 +258,130 @@ inline Player& getPlayerReference(const std::string& name)
         }
     }
 
-    std::cerr << "ERROR: Player '" + name + "' not found!" << '\n';
+    logEvent(EVENT_PLAYER_NOT_FOUND, name, suggestPlayerNames(name));
     return playerList[0];
 }
 
-inline bool playerExists(const std::string& name)
+// Prefix index over the roster names, built on first use and then kept in
+// step by addPlayer and removePlayer.
+inline NameIndex& getPlayerNameIndex()
 {
-    for (int i = 1; i < playerList.size(); i++)
+    static NameIndex index = []()
     {
-        if (playerList[i].name == name)
+        std::vector<std::string> names;
+        for (int i = 1; i < playerList.size(); i++)
         {
-            return true;
+            names.push_back(playerList[i].name);
         }
+
+        NameIndex rosterIndex;
+        rosterIndex.build(std::move(names));
+        return rosterIndex;
+    }();
+
+    return index;
+}
+
+// Counting Bloom filter over the roster names in front of the name index, so
+// names that are definitely new never reach it. The counts feed the
+// instrumentation report.
+struct PlayerNameFilter
+{
+    CountingBloomFilter bloom;
+    long long lookups = 0;
+    long long definitelyNew = 0;
+    long long falsePositives = 0;
+
+    void rebuild(size_t capacity)
+    {
+        bloom.reset(capacity);
+        for (int i = 1; i < playerList.size(); i++)
+        {
+            bloom.insert(playerList[i].name);
+        }
+    }
+};
+
+inline PlayerNameFilter& getPlayerNameFilter()
+{
+    static PlayerNameFilter filter = []()
+    {
+        PlayerNameFilter rosterFilter;
+        rosterFilter.rebuild(2 * playerList.size());
+        return rosterFilter;
+    }();
+
+    return filter;
+}
+
+inline void addPlayer(const std::string& name)
+{
+    getPlayerNameIndex().insert(name);
+
+    PlayerNameFilter& filter = getPlayerNameFilter();
+    if (filter.bloom.size() >= filter.bloom.capacity())
+    {
+        filter.rebuild(2 * filter.bloom.capacity());
     }
+    filter.bloom.insert(name);
+    if (playerFuzzyIndex())
+    {
+        playerFuzzyIndex()->insert(name);
+    }
+
+    Player newPlayer;
+    newPlayer.name = name;
+    playerList.push_back(newPlayer);
+}
 
-    return false;
+// Drops a name from the lookup structures once it has left playerList.
+inline void unindexPlayerName(const std::string& name)
+{
+    getPlayerNameIndex().erase(name);
+    getPlayerNameFilter().bloom.erase(name);
+    if (playerFuzzyIndex())
+    {
+        playerFuzzyIndex()->erase(name);
+    }
+}
+
+inline void removePlayer(const std::string& name)
+{
+    int index = getPlayerIndex(name);
+    if (index > 0)
+    {
+        playerList.erase(playerList.begin() + index);
+        unindexPlayerName(name);
+    }
+}
+
+inline bool playerExists(const std::string& name)
+{
+    PROFILE_ALLOCATIONS("playerExists");
+    TRACE_SPAN("playerExists");
+    PlayerNameFilter& filter = getPlayerNameFilter();
+    filter.lookups++;
+
+    if (!filter.bloom.mayContain(name))
+    {
+        filter.definitelyNew++;
+        return false;
+    }
+
+    bool exists = getPlayerNameIndex().contains(name);
+    filter.falsePositives += exists ? 0 : 1;
+
+    return exists;
+}
+
+inline void printLookupInstrumentation()
+{
+    const PlayerNameFilter& filter = getPlayerNameFilter();
+    long long absentLookups = filter.definitelyNew + filter.falsePositives;
+
+    std::cerr << "playerExists: " << filter.lookups << " lookups, " << filter.definitelyNew
+        << " answered by the Bloom filter, " << filter.falsePositives << " false positives ("
+        << (absentLookups == 0 ? 0.0 : 100.0 * filter.falsePositives / absentLookups) << "% of new names)" << '\n';
 }
 
 inline void printMenu()
@@ -140,6 +393,12 @@ inline void printMenu()
     std::cout << "4. Print Player Winnings" << '\n';
     std::cout << "5. Set Pot" << '\n';
     std::cout << "6. Exit & Save Player List" << '\n';
+    std::cout << "7. Push/Fold Chart" << '\n';
+    std::cout << "8. Simulate Hands" << '\n';
+    std::cout << "9. Import Hand History" << '\n';
+    std::cout << "10. Player Statistics" << '\n';
+    std::cout << "11. Season Leaderboard" << '\n';
+    std::cout << "12. Bulk Chip Entry" << '\n';
 }
 
 inline void printPlayers()
@@ -178,11 +437,11 @@ int getIntegerInput(enum IntInputValidationOptions option)
         std::cin >> input;
         std::cout << '\n';
 
-        while (std::cin.fail() || input <= 0 || input > 6)
+        while (std::cin.fail() || input <= 0 || input > MENU_OPTION_COUNT)
         {
             std::cin.clear();
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cerr << "ERROR: Please enter a valid menu option: ";
+            logEvent(EVENT_INVALID_MENU_OPTION);
             std::cin >> input;
         }
 
@@ -198,8 +457,7 @@ int getIntegerInput(enum IntInputValidationOptions option)
         {
             std::cin.clear();
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cerr
-                << "ERROR: Invalid amount! Enter a valid number of chips: ";
+            logEvent(EVENT_INVALID_CHIP_AMOUNT);
             std::cin >> input;
         }
 
@@ -215,7 +473,71 @@ int getIntegerInput(enum IntInputValidationOptions option)
         {
             std::cin.clear();
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cerr << "ERROR: Please enter a valid menu option: ";
+            logEvent(EVENT_INVALID_MENU_OPTION);
+            std::cin >> input;
+        }
+
+        return input;
+    }
+
+    case PAID_PLACES:
+    {
+        int input;
+        std::cin >> input;
+
+        while (std::cin.fail() || input <= 0)
+        {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            logEvent(EVENT_INVALID_PLACES);
+            std::cin >> input;
+        }
+
+        return input;
+    }
+
+    case SIMULATION_HANDS:
+    {
+        int input;
+        std::cin >> input;
+
+        while (std::cin.fail() || input <= 0)
+        {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            logEvent(EVENT_INVALID_HANDS);
+            std::cin >> input;
+        }
+
+        return input;
+    }
+
+    case WINNINGS_REPORT:
+    {
+        int input;
+        std::cin >> input;
+
+        while (std::cin.fail() || input < 1 || input > 3)
+        {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            logEvent(EVENT_INVALID_MENU_OPTION);
+            std::cin >> input;
+        }
+
+        return input;
+    }
+
+    case REPORT_COUNT:
+    {
+        int input;
+        std::cin >> input;
+
+        while (std::cin.fail() || input <= 0)
+        {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            logEvent(EVENT_INVALID_PLAYER_COUNT);
             std::cin >> input;
         }
 
@@ -224,8 +546,39 @@ int getIntegerInput(enum IntInputValidationOptions option)
     }
 }
 
+float getFloatInput(enum FloatInputValidationOptions option)
+{
+    float input;
+    std::cin >> input;
+
+    while (std::cin.fail() || input < 0)
+    {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+        switch (option)
+        {
+        case POT_AMOUNT:
+            logEvent(EVENT_INVALID_POT_AMOUNT);
+            break;
+        case BLIND_AMOUNT:
+            logEvent(EVENT_INVALID_BLIND_AMOUNT);
+            break;
+        case PAYOUT_AMOUNT:
+            logEvent(EVENT_INVALID_PAYOUT_AMOUNT);
+            break;
+        }
+
+        std::cin >> input;
+    }
+
+    return input;
+}
+
 std::string getStringInput(enum StrInputValidationOptions option)
 {
+    PROFILE_ALLOCATIONS("getStringInput");
+    TRACE_SPAN("getStringInput");
     switch (option)
     {
     case ADD_PLAYER:
@@ -235,8 +588,7 @@ std::string getStringInput(enum StrInputValidationOptions option)
 
         while (input == "NONE" || playerExists(input))
         {
-            std::cerr << "ERROR: Name is not allowed or taken! Please enter a "
-                "different name: ";
+            logEvent(EVENT_NAME_TAKEN);
             std::cin >> input;
         }
 
@@ -245,13 +597,12 @@ std::string getStringInput(enum StrInputValidationOptions option)
 
     case REMOVE_PLAYER:
     {
-        std::string input;
-        std::cin >> input;
+        std::string input = readCompletedWord(getPlayerNameIndex());
 
         while (!playerExists(input))
         {
-            std::cerr << "ERROR: Player not found! Please enter a valid name: ";
-            std::cin >> input;
+            logEvent(EVENT_PLAYER_NOT_FOUND_RETRY, suggestPlayerNames(input));
+            input = readCompletedWord(getPlayerNameIndex());
         }
 
         return input;
@@ -259,13 +610,12 @@ std::string getStringInput(enum StrInputValidationOptions option)
 
     case EDIT_PLAYER_CHIPS:
     {
-        std::string input;
-        std::cin >> input;
+        std::string input = readCompletedWord(getPlayerNameIndex());
 
         while (!playerExists(input))
         {
-            std::cerr << "ERROR: Player not found! Please enter a valid name: ";
-            std::cin >> input;
+            logEvent(EVENT_PLAYER_NOT_FOUND_RETRY, suggestPlayerNames(input));
+            input = readCompletedWord(getPlayerNameIndex());
         }
 
         return input;
@@ -0,0 +1,483 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POKERPAL_SSE2 1
+#endif
+
+#include "Equity.h"
+#include "Parallel.h"
+#include "PokerPal.h"
+
+constexpr int MAX_PUSH_FOLD_SEATS = 10;
+constexpr int PUSH_FOLD_ITERATIONS = 400;
+
+// Probability of playing each hand class.
+using HandRange = std::array<float, NUM_HAND_CLASSES>;
+
+// A short-stacked spot. Seats are listed in preflop action order, so the last
+// two seats are the small blind and the big blind.
+struct PushFoldSpot
+{
+    std::vector<float> stacks;
+    float smallBlind;
+    float bigBlind;
+    float ante;
+    std::vector<float> payouts;
+};
+
+struct PushFoldSolution
+{
+    std::vector<HandRange> pushRanges;              // [pusher]
+    std::vector<std::vector<HandRange>> callRanges; // [pusher][caller]
+    int iterations;
+};
+
+// Four independent accumulators, so each add does not wait on the one
+// before it; with SSE each accumulator holds four lanes. The order of the
+// additions differs from a plain loop, which is why compilers will not do
+// this on their own without -ffast-math.
+inline float dotProduct(const float* a, const float* b, int count)
+{
+    int i = 0;
+#ifdef POKERPAL_SSE2
+    __m128 sums[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+    for (; i + 16 <= count; i += 16)
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            sums[lane] = _mm_add_ps(sums[lane], _mm_mul_ps(_mm_loadu_ps(a + i + 4 * lane), _mm_loadu_ps(b + i + 4 * lane)));
+        }
+    }
+
+    __m128 total = _mm_add_ps(_mm_add_ps(sums[0], sums[1]), _mm_add_ps(sums[2], sums[3]));
+    for (; i + 4 <= count; i += 4)
+    {
+        total = _mm_add_ps(total, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, total);
+#else
+    float lanes[4] = {};
+    for (; i + 4 <= count; i += 4)
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            lanes[lane] += a[i + lane] * b[i + lane];
+        }
+    }
+#endif
+
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < count; i++)
+    {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+// Share of all 1326 combos that each hand class makes up.
+inline const HandRange& getHandClassWeights()
+{
+    static const HandRange weights = []()
+    {
+        HandRange classWeights;
+        for (int h = 0; h < NUM_HAND_CLASSES; h++)
+        {
+            classWeights[h] = handClassComboCount(h) / static_cast<float>(NUM_HOLE_COMBOS);
+        }
+
+        return classWeights;
+    }();
+
+    return weights;
+}
+
+// Malmuth-Harville ICM: each remaining player takes the next paid place with
+// probability proportional to their stack. Walks subsets of unplaced players
+// instead of finishing orders, so a full table costs 2^n * n steps.
+inline std::vector<float> calculateIcmEquities(const std::vector<float>& stacks, const std::vector<float>& payouts)
+{
+    int seatCount = static_cast<int>(stacks.size());
+    std::vector<double> remainingProbability(size_t(1) << seatCount, 0.0);
+    std::vector<double> equities(seatCount, 0.0);
+
+    uint32_t everyone = (1u << seatCount) - 1;
+    remainingProbability[everyone] = 1.0;
+
+    for (uint32_t remaining = everyone; remaining > 0; remaining--)
+    {
+        double probability = remainingProbability[remaining];
+        size_t place = seatCount - std::popcount(remaining);
+
+        if (probability == 0.0 || place >= payouts.size())
+        {
+            continue;
+        }
+
+        double totalChips = 0.0;
+        for (int i = 0; i < seatCount; i++)
+        {
+            if (remaining & (1u << i))
+            {
+                totalChips += stacks[i];
+            }
+        }
+
+        if (totalChips <= 0.0)
+        {
+            continue;
+        }
+
+        for (int i = 0; i < seatCount; i++)
+        {
+            if ((remaining & (1u << i)) && stacks[i] > 0.0f)
+            {
+                double share = probability * stacks[i] / totalChips;
+                equities[i] += share * payouts[place];
+                remainingProbability[remaining & ~(1u << i)] += share;
+            }
+        }
+    }
+
+    return std::vector<float>(equities.begin(), equities.end());
+}
+
+// Solves first-in push/fold with fictitious play. When the action folds to a
+// seat it either shoves or folds; players behind it call or fold, and the
+// first call ends the hand heads-up. Each iteration computes every seat's best
+// response against the averaged ranges of the others, then mixes it into the
+// average. Card removal between the two hands is ignored.
+inline PushFoldSolution solvePushFold(const PushFoldSpot& spot, const EquityMatrix& equity)
+{
+    const int seatCount = static_cast<int>(spot.stacks.size());
+    const HandRange& weights = getHandClassWeights();
+
+    std::vector<float> posts(seatCount);
+    float totalPosts = 0.0f;
+    for (int i = 0; i < seatCount; i++)
+    {
+        float blind = (i == seatCount - 2 ? spot.smallBlind : 0.0f) + (i == seatCount - 1 ? spot.bigBlind : 0.0f);
+        posts[i] = std::min(spot.stacks[i], spot.ante + blind);
+        totalPosts += posts[i];
+    }
+
+    // ICM value of every terminal outcome; these do not depend on the ranges.
+    std::vector<float> afterPosts(seatCount);
+    for (int i = 0; i < seatCount; i++)
+    {
+        afterPosts[i] = spot.stacks[i] - posts[i];
+    }
+
+    std::vector<float> walkStacks = afterPosts;
+    walkStacks[seatCount - 1] += totalPosts;
+    std::vector<float> walkValue = calculateIcmEquities(walkStacks, spot.payouts);
+
+    std::vector<std::vector<float>> stealValue(seatCount);
+    std::vector<std::vector<std::vector<float>>> pusherWinsValue(seatCount, std::vector<std::vector<float>>(seatCount));
+    std::vector<std::vector<std::vector<float>>> callerWinsValue(seatCount, std::vector<std::vector<float>>(seatCount));
+
+    for (int pusher = 0; pusher < seatCount - 1; pusher++)
+    {
+        std::vector<float> stealStacks = afterPosts;
+        stealStacks[pusher] += totalPosts;
+        stealValue[pusher] = calculateIcmEquities(stealStacks, spot.payouts);
+
+        for (int caller = pusher + 1; caller < seatCount; caller++)
+        {
+            float matched = std::min(spot.stacks[pusher], spot.stacks[caller]);
+            float deadMoney = totalPosts - posts[pusher] - posts[caller];
+
+            std::vector<float> showdownStacks = afterPosts;
+            showdownStacks[pusher] = spot.stacks[pusher] + matched + deadMoney;
+            showdownStacks[caller] = spot.stacks[caller] - matched;
+            pusherWinsValue[pusher][caller] = calculateIcmEquities(showdownStacks, spot.payouts);
+
+            showdownStacks[pusher] = spot.stacks[pusher] - matched;
+            showdownStacks[caller] = spot.stacks[caller] + matched + deadMoney;
+            callerWinsValue[pusher][caller] = calculateIcmEquities(showdownStacks, spot.payouts);
+        }
+    }
+
+    PushFoldSolution solution;
+    HandRange half;
+    half.fill(0.5f);
+    solution.pushRanges.assign(seatCount, half);
+    solution.callRanges.assign(seatCount, std::vector<HandRange>(seatCount, half));
+    solution.iterations = 0;
+
+    std::vector<HandRange> pushValues(seatCount);
+    std::vector<std::vector<HandRange>> bestCalls(seatCount, std::vector<HandRange>(seatCount));
+    std::vector<HandRange> bestPushes(seatCount);
+    std::vector<std::vector<float>> foldValue(seatCount + 1);
+
+    // Started once for every iteration rather than once per iteration.
+    WorkerPool workers;
+
+    for (int iteration = 0; iteration < PUSH_FOLD_ITERATIONS; iteration++)
+    {
+        // Every seat's push range is analysed independently of the others.
+        workers.parallelFor(seatCount - 1, [&](size_t pusherIndex)
+        {
+            const int pusher = static_cast<int>(pusherIndex);
+            const HandRange& pushRange = solution.pushRanges[pusher];
+
+            HandRange weightedPush;
+            for (int h = 0; h < NUM_HAND_CLASSES; h++)
+            {
+                weightedPush[h] = weights[h] * pushRange[h];
+            }
+
+            float pushWeight = 0.0f;
+            for (int h = 0; h < NUM_HAND_CLASSES; h++)
+            {
+                pushWeight += weightedPush[h];
+            }
+
+            pushWeight = std::max(pushWeight, 1e-9f);
+
+            // Equity of each calling hand against this seat's pushing range.
+            HandRange callerEquity;
+            for (int k = 0; k < NUM_HAND_CLASSES; k++)
+            {
+                callerEquity[k] = dotProduct(equity.row(k), weightedPush.data(), NUM_HAND_CLASSES) / pushWeight;
+            }
+
+            std::vector<float> callFrequency(seatCount, 0.0f);
+            std::vector<HandRange> pusherEquity(seatCount);
+            std::vector<float> averageEquity(seatCount, 0.5f);
+
+            for (int caller = pusher + 1; caller < seatCount; caller++)
+            {
+                HandRange weightedCall;
+                for (int k = 0; k < NUM_HAND_CLASSES; k++)
+                {
+                    weightedCall[k] = weights[k] * solution.callRanges[pusher][caller][k];
+                }
+
+                float callWeight = 0.0f;
+                for (int k = 0; k < NUM_HAND_CLASSES; k++)
+                {
+                    callWeight += weightedCall[k];
+                }
+
+                callFrequency[caller] = callWeight;
+                callWeight = std::max(callWeight, 1e-9f);
+
+                for (int h = 0; h < NUM_HAND_CLASSES; h++)
+                {
+                    pusherEquity[caller][h] = dotProduct(equity.row(h), weightedCall.data(), NUM_HAND_CLASSES) / callWeight;
+                }
+
+                averageEquity[caller] = dotProduct(pusherEquity[caller].data(), weightedPush.data(), NUM_HAND_CLASSES) / pushWeight;
+            }
+
+            // Walk back from the big blind: the value for each caller of
+            // folding is what happens once everyone behind them has acted.
+            std::vector<float> continuation = stealValue[pusher];
+            HandRange pushValue;
+            pushValue.fill(stealValue[pusher][pusher]);
+
+            for (int caller = seatCount - 1; caller > pusher; caller--)
+            {
+                const std::vector<float>& pusherWins = pusherWinsValue[pusher][caller];
+                const std::vector<float>& callerWins = callerWinsValue[pusher][caller];
+
+                float callValueIfWin = callerWins[caller];
+                float callValueIfLose = pusherWins[caller];
+                float foldOption = continuation[caller];
+
+                for (int k = 0; k < NUM_HAND_CLASSES; k++)
+                {
+                    float callValue = callerEquity[k] * callValueIfWin + (1.0f - callerEquity[k]) * callValueIfLose;
+                    bestCalls[pusher][caller][k] = callValue > foldOption ? 1.0f : 0.0f;
+                }
+
+                float frequency = callFrequency[caller];
+                for (int h = 0; h < NUM_HAND_CLASSES; h++)
+                {
+                    float showdown = pusherEquity[caller][h] * pusherWins[pusher]
+                        + (1.0f - pusherEquity[caller][h]) * callerWins[pusher];
+                    pushValue[h] = frequency * showdown + (1.0f - frequency) * pushValue[h];
+                }
+
+                for (int i = 0; i < seatCount; i++)
+                {
+                    float showdown = averageEquity[caller] * pusherWins[i] + (1.0f - averageEquity[caller]) * callerWins[i];
+                    continuation[i] = frequency * showdown + (1.0f - frequency) * continuation[i];
+                }
+            }
+
+            pushValues[pusher] = pushValue;
+            foldValue[pusher] = continuation; // value once this seat has pushed, resolved below
+        });
+
+        // Folding hands the action to the next seat, so fold values chain back
+        // from the big blind's walk.
+        std::vector<float> nextSeatValue = walkValue;
+        for (int pusher = seatCount - 2; pusher >= 0; pusher--)
+        {
+            const HandRange& pushRange = solution.pushRanges[pusher];
+            float pushFrequency = dotProduct(weights.data(), pushRange.data(), NUM_HAND_CLASSES);
+            float foldOption = nextSeatValue[pusher];
+
+            for (int h = 0; h < NUM_HAND_CLASSES; h++)
+            {
+                bestPushes[pusher][h] = pushValues[pusher][h] > foldOption ? 1.0f : 0.0f;
+            }
+
+            for (int i = 0; i < seatCount; i++)
+            {
+                nextSeatValue[i] = pushFrequency * foldValue[pusher][i] + (1.0f - pushFrequency) * nextSeatValue[i];
+            }
+        }
+
+        // Fictitious play: mix the best responses into the running averages.
+        float step = 1.0f / (iteration + 2);
+
+        for (int pusher = 0; pusher < seatCount - 1; pusher++)
+        {
+            for (int h = 0; h < NUM_HAND_CLASSES; h++)
+            {
+                solution.pushRanges[pusher][h] += step * (bestPushes[pusher][h] - solution.pushRanges[pusher][h]);
+            }
+
+            for (int caller = pusher + 1; caller < seatCount; caller++)
+            {
+                HandRange& callRange = solution.callRanges[pusher][caller];
+                for (int k = 0; k < NUM_HAND_CLASSES; k++)
+                {
+                    callRange[k] += step * (bestCalls[pusher][caller][k] - callRange[k]);
+                }
+            }
+        }
+
+        solution.iterations = iteration + 1;
+    }
+
+    return solution;
+}
+
+// Share of all combos played at least half of the time.
+inline float rangePercentage(const HandRange& range)
+{
+    const HandRange& weights = getHandClassWeights();
+    float total = 0.0f;
+
+    for (int h = 0; h < NUM_HAND_CLASSES; h++)
+    {
+        total += range[h] >= 0.5f ? weights[h] : 0.0f;
+    }
+
+    return total * 100.0f;
+}
+
+inline void printHandRangeChart(const HandRange& range)
+{
+    for (int row = 0; row < NUM_RANKS; row++)
+    {
+        for (int column = 0; column < NUM_RANKS; column++)
+        {
+            int handClass = row * NUM_RANKS + column;
+            std::string cell = range[handClass] >= 0.5f ? handClassName(handClass) : "-";
+            std::cout << std::setw(4) << cell;
+        }
+
+        std::cout << '\n';
+    }
+}
+
+inline std::string seatPositionName(int seat, int seatCount)
+{
+    if (seat == seatCount - 1)
+    {
+        return "BB";
+    }
+    if (seat == seatCount - 2)
+    {
+        return "SB";
+    }
+    if (seat == seatCount - 3)
+    {
+        return "BTN";
+    }
+
+    return "BTN-" + std::to_string(seatCount - 3 - seat);
+}
+
+// Builds a spot from every loaded player with chips, in roster order, and
+// prints the push range of each seat and how often each seat calls.
+inline void runPushFoldSolver()
+{
+    std::vector<const Player*> seats;
+    PushFoldSpot spot;
+
+    for (int i = 1; i < playerList.size(); i++)
+    {
+        float stack = calculateWinnings(playerList[i]);
+        if (stack > 0.0f)
+        {
+            seats.push_back(&playerList[i]);
+            spot.stacks.push_back(stack);
+        }
+    }
+
+    if (seats.size() < 2 || seats.size() > MAX_PUSH_FOLD_SEATS)
+    {
+        std::cerr << "ERROR: Push/fold needs between 2 and " << MAX_PUSH_FOLD_SEATS
+            << " players with chips entered!" << '\n';
+        return;
+    }
+
+    std::cout << "Enter the small blind: ";
+    spot.smallBlind = getFloatInput(BLIND_AMOUNT);
+    std::cout << "Enter the big blind: ";
+    spot.bigBlind = getFloatInput(BLIND_AMOUNT);
+    std::cout << "Enter the ante: ";
+    spot.ante = getFloatInput(BLIND_AMOUNT);
+
+    std::cout << "Enter the number of paid places: ";
+    int paidPlaces = std::min<int>(getIntegerInput(PAID_PLACES), static_cast<int>(seats.size()));
+    for (int place = 0; place < paidPlaces; place++)
+    {
+        std::cout << "Enter the payout for place " << place + 1 << ": ";
+        spot.payouts.push_back(getFloatInput(PAYOUT_AMOUNT));
+    }
+
+    const EquityMatrix& equity = getPreflopEquityMatrix();
+
+    auto start = std::chrono::steady_clock::now();
+    PushFoldSolution solution = solvePushFold(spot, equity);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << '\n' << "Solved in " << solution.iterations << " iterations (" << elapsed.count() << "s)" << '\n' << '\n';
+
+    int seatCount = static_cast<int>(seats.size());
+    for (int pusher = 0; pusher < seatCount - 1; pusher++)
+    {
+        std::cout << seats[pusher]->name << " (" << seatPositionName(pusher, seatCount) << ", $"
+            << spot.stacks[pusher] << ") pushes " << rangePercentage(solution.pushRanges[pusher]) << "%:" << '\n';
+        printHandRangeChart(solution.pushRanges[pusher]);
+        std::cout << '\n';
+    }
+
+    for (int caller = 1; caller < seatCount; caller++)
+    {
+        std::cout << seats[caller]->name << " (" << seatPositionName(caller, seatCount) << ") calls:";
+        for (int pusher = 0; pusher < caller; pusher++)
+        {
+            std::cout << " vs " << seats[pusher]->name << " " << rangePercentage(solution.callRanges[pusher][caller]) << "%";
+        }
+
+        std::cout << '\n';
+    }
+}
@@ -0,0 +1,849 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Checksum.h"
+#include "Persistence.h"
+#include "PokerPal.h"
+
+const std::string REPLICA_LOG_FILE = "replica.log";
+const std::string REPLICA_OUTBOX_FILE = "replica.outbox";
+const std::string REPLICA_LOG_HEADER = "POKERPAL-REPLICA 1";
+const std::string REPLICA_DELTA_HEADER = "POKERPAL-DELTA 1";
+const std::string REPLICA_INBOX_DIRECTORY = "replica.inbox";
+
+constexpr size_t REPLICA_COMPACT_MINIMUM = 4096; // log entries before a load considers compacting
+
+// One delta-state fragment, and one line of a log or delta file:
+//   A <name> <replica> <counter>                        the name was added with this tag
+//   R <name> <replica> <counter>                        the add with this tag was removed
+//   C <name> <colour> <replica> <increments> <decrements>  one replica's totals for one colour
+struct ReplicaEntry
+{
+    char type = 0;
+    std::string name;
+    uint64_t replica = 0;
+    uint64_t counter = 0;
+    int colour = 0;
+    long long increments = 0;
+    long long decrements = 0;
+};
+
+inline void writeReplicaEntry(std::ostream& out, const ReplicaEntry& entry)
+{
+    out << entry.type << ' ' << entry.name << ' ';
+    if (entry.type == 'C')
+    {
+        out << entry.colour << ' ' << std::hex << entry.replica << std::dec << ' ' << entry.increments << ' ' << entry.decrements;
+    }
+    else
+    {
+        out << std::hex << entry.replica << std::dec << ' ' << entry.counter;
+    }
+    out << '\n';
+}
+
+inline bool parseReplicaEntry(std::string_view line, ReplicaEntry& entry)
+{
+    const char* end = line.data() + line.size();
+    auto field = [&](std::string_view& text)
+    {
+        size_t start = std::min(line.find_first_not_of(' '), line.size());
+        size_t stop = std::min(line.find(' ', start), line.size());
+        text = line.substr(start, stop - start);
+        line.remove_prefix(stop);
+        return !text.empty();
+    };
+    auto number = [&](auto& value, int base)
+    {
+        std::string_view text;
+        return field(text) && std::from_chars(text.data(), text.data() + text.size(), value, base).ptr == text.data() + text.size();
+    };
+
+    std::string_view type;
+    std::string_view name;
+    if (!field(type) || type.size() != 1 || !field(name))
+    {
+        return false;
+    }
+    entry.type = type[0];
+    entry.name = std::string(name);
+
+    if (entry.type == 'C')
+    {
+        bool parsed = number(entry.colour, 10) && number(entry.replica, 16) && number(entry.increments, 10) && number(entry.decrements, 10);
+        return parsed && line.data() == end && entry.colour >= 0 && entry.colour < 5 && entry.increments >= 0 && entry.decrements >= 0;
+    }
+
+    bool parsed = number(entry.replica, 16) && number(entry.counter, 10);
+    return parsed && line.data() == end && (entry.type == 'A' || entry.type == 'R');
+}
+
+// The roster as an observed-remove set and every player's chips as one
+// PN-counter per colour, so replicas that change them independently always
+// converge once they have seen each other's deltas, in any order and any
+// number of times.
+//
+// Every change, local or merged, is a ReplicaEntry. Entries that change the
+// state are appended to replica.log, which is replayed (and compacted once it
+// is mostly redundant) on open, and to replica.outbox, which an export ships
+// and empties. Merged entries go to the outbox too, so changes spread through
+// intermediate replicas, but only when they were new here, so they never echo
+// back and forth. Merging touches only the players the deltas name.
+//
+// Entries are written in checksummed blocks (see frameTextBlocks). A block
+// that fails its checksum is skipped; the entries in it come back with the
+// next full export from a replica that has them.
+class ReplicatedLedger
+{
+public:
+    bool open()
+    {
+        std::ifstream log(REPLICA_LOG_FILE, std::ios::binary);
+        std::string header;
+
+        if (!log.is_open())
+        {
+            replica = std::random_device()() * 0x100000000ULL + std::random_device()();
+            writeLog(false);
+        }
+        else if (!std::getline(log, header) || header.rfind(REPLICA_LOG_HEADER + ' ', 0) != 0)
+        {
+            std::cerr << "ERROR: '" << REPLICA_LOG_FILE << "' is not a PokerPal replica log!" << '\n';
+            return false;
+        }
+        else
+        {
+            replica = std::stoull(header.substr(REPLICA_LOG_HEADER.size() + 1), nullptr, 16);
+
+            std::string entries((std::istreambuf_iterator<char>(log)), std::istreambuf_iterator<char>());
+            size_t entriesRead = 0;
+            ReplicaEntry entry;
+
+            TextBlockScan scan = readTextBlocks(entries, REPLICA_LOG_FILE, [&](std::string_view line, bool intact)
+            {
+                if (intact && parseReplicaEntry(line, entry))
+                {
+                    apply(entry);
+                    entriesRead++;
+                }
+            });
+
+            if (entriesRead > REPLICA_COMPACT_MINIMUM && entriesRead > 2 * stateEntryCount())
+            {
+                writeLog(true);
+            }
+            else if (scan.tornTail)
+            {
+                // Cut off the half-written save so later saves frame cleanly.
+                FileWrite cut;
+                cut.path = REPLICA_LOG_FILE;
+                cut.mode = WRITE_FILE_AT;
+                cut.offset = header.size() + 1 + scan.framedBytes;
+                getPersistenceQueue().submit(std::move(cut));
+            }
+        }
+
+        return true;
+    }
+
+    uint64_t replicaId() const { return replica; }
+
+    // Every name ever added, in the order this replica first saw them.
+    const std::vector<std::string>& names() const { return nameOrder; }
+
+    bool contains(const std::string& name) const
+    {
+        auto player = players.find(name);
+        return player != players.end() && !player->second.liveTags.empty();
+    }
+
+    long long chips(const std::string& name, int colour) const
+    {
+        auto player = players.find(name);
+        return player == players.end() ? 0 : player->second.totals[colour];
+    }
+
+    void addPlayer(const std::string& name)
+    {
+        record({ 'A', name, replica, ++clock });
+    }
+
+    // Removes every add of the name this replica has seen. A concurrent add
+    // elsewhere survives, as the observed-remove set intends.
+    void removePlayer(const std::string& name)
+    {
+        auto player = players.find(name);
+        if (player == players.end())
+        {
+            return;
+        }
+
+        std::vector<ReplicaTag> tags = player->second.liveTags;
+        for (const ReplicaTag& tag : tags)
+        {
+            record({ 'R', name, tag.replica, tag.counter });
+        }
+    }
+
+    void addChips(const std::string& name, int colour, long long delta)
+    {
+        ReplicaCounter own = { replica, 0, 0 };
+        auto player = players.find(name);
+        if (player != players.end())
+        {
+            for (const ReplicaCounter& counter : player->second.counters[colour])
+            {
+                own = counter.replica == replica ? counter : own;
+            }
+        }
+
+        (delta > 0 ? own.increments : own.decrements) += delta > 0 ? delta : -delta;
+
+        ReplicaEntry entry;
+        entry.type = 'C';
+        entry.name = name;
+        entry.colour = colour;
+        entry.replica = replica;
+        entry.increments = own.increments;
+        entry.decrements = own.decrements;
+        record(entry);
+    }
+
+    // Joins a delta file into this replica, noting the players whose entries
+    // were new. Returns false if it is not a delta file.
+    bool merge(std::istream& in, const std::string& path, size_t& entriesRead, size_t& entriesNew,
+        std::vector<std::string>& changedNames)
+    {
+        std::string header;
+        if (!std::getline(in, header) || header != REPLICA_DELTA_HEADER)
+        {
+            return false;
+        }
+
+        std::string entries((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        ReplicaEntry entry;
+        entriesRead = 0;
+        entriesNew = 0;
+
+        readTextBlocks(entries, path, [&](std::string_view line, bool intact)
+        {
+            if (!intact || !parseReplicaEntry(line, entry))
+            {
+                return;
+            }
+
+            entriesRead++;
+            if (apply(entry))
+            {
+                writeReplicaEntry(unsaved, entry);
+                changedNames.push_back(entry.name);
+                entriesNew++;
+            }
+        });
+
+        save();
+        return true;
+    }
+
+    // Renames the outbox to replica.outbox.<n>, so entries a running session
+    // appends meanwhile start a fresh outbox, and returns every outbox moved
+    // aside that has not been exported yet, oldest first. One left behind by
+    // a failed export goes out again with this one.
+    std::vector<std::string> claimOutbox()
+    {
+        getPersistenceQueue().waitFor(REPLICA_OUTBOX_FILE);
+
+        std::vector<std::pair<uint64_t, std::string>> claimed;
+        std::error_code error;
+        for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(".", error))
+        {
+            std::string name = file.path().filename().string();
+            uint64_t number = 0;
+            if (name.size() > REPLICA_OUTBOX_FILE.size() + 1 && name.rfind(REPLICA_OUTBOX_FILE + '.', 0) == 0
+                && std::from_chars(name.data() + REPLICA_OUTBOX_FILE.size() + 1, name.data() + name.size(), number).ptr
+                    == name.data() + name.size())
+            {
+                claimed.emplace_back(number, name);
+            }
+        }
+        std::sort(claimed.begin(), claimed.end());
+
+        std::string moved = REPLICA_OUTBOX_FILE + '.' + std::to_string(claimed.empty() ? 1 : claimed.back().first + 1);
+        std::filesystem::rename(REPLICA_OUTBOX_FILE, moved, error);
+        if (!error)
+        {
+            claimed.emplace_back(0, moved);
+        }
+
+        std::vector<std::string> paths;
+        for (auto& [number, path] : claimed)
+        {
+            paths.push_back(std::move(path));
+        }
+
+        return paths;
+    }
+
+    // The claimed outboxes as one delta.
+    static void exportOutbox(std::ostream& out, const std::vector<std::string>& claimed)
+    {
+        out << REPLICA_DELTA_HEADER << '\n';
+        for (const std::string& path : claimed)
+        {
+            std::ifstream outbox(path, std::ios::binary);
+            if (outbox.peek() != std::ifstream::traits_type::eof())
+            {
+                out << outbox.rdbuf();
+            }
+        }
+    }
+
+    // Deletes claimed outboxes once their delta is safely written.
+    static void releaseOutbox(const std::vector<std::string>& claimed)
+    {
+        for (const std::string& path : claimed)
+        {
+            std::error_code error;
+            std::filesystem::remove(path, error);
+        }
+    }
+
+    // The whole state as one delta, for a replica that missed some.
+    void exportState(std::ostream& out) const
+    {
+        std::ostringstream state;
+        writeState(state);
+        out << REPLICA_DELTA_HEADER << '\n' << frameTextBlocks(state.str());
+    }
+
+private:
+    struct ReplicaTag
+    {
+        uint64_t replica;
+        uint64_t counter;
+
+        bool operator==(const ReplicaTag& other) const { return replica == other.replica && counter == other.counter; }
+    };
+
+    struct ReplicaTagHash
+    {
+        size_t operator()(const ReplicaTag& tag) const { return std::hash<uint64_t>()(tag.replica * 0x9E3779B97F4A7C15ULL ^ tag.counter); }
+    };
+
+    struct ReplicaCounter
+    {
+        uint64_t replica;
+        long long increments;
+        long long decrements;
+    };
+
+    struct ReplicatedPlayer
+    {
+        std::vector<ReplicaTag> liveTags;
+        std::vector<ReplicaTag> removedTags;
+        std::array<std::vector<ReplicaCounter>, 5> counters;
+        std::array<long long, 5> totals{};
+    };
+
+    ReplicatedPlayer& playerNamed(const std::string& name)
+    {
+        auto [player, inserted] = players.try_emplace(name);
+        if (inserted)
+        {
+            nameOrder.push_back(name);
+        }
+
+        return player->second;
+    }
+
+    // The join. Returns whether the entry changed anything.
+    bool apply(const ReplicaEntry& entry)
+    {
+        ReplicatedPlayer& player = playerNamed(entry.name);
+        ReplicaTag tag = { entry.replica, entry.counter };
+
+        if (entry.type != 'C' && entry.replica == replica)
+        {
+            clock = std::max(clock, entry.counter);
+        }
+
+        if (entry.type == 'A')
+        {
+            if (removed.count(tag) > 0 || std::find(player.liveTags.begin(), player.liveTags.end(), tag) != player.liveTags.end())
+            {
+                return false;
+            }
+
+            player.liveTags.push_back(tag);
+            return true;
+        }
+        else if (entry.type == 'R')
+        {
+            if (!removed.insert(tag).second)
+            {
+                return false;
+            }
+
+            player.removedTags.push_back(tag);
+            player.liveTags.erase(std::remove(player.liveTags.begin(), player.liveTags.end(), tag), player.liveTags.end());
+            return true;
+        }
+
+        std::vector<ReplicaCounter>& counters = player.counters[entry.colour];
+        auto counter = std::find_if(counters.begin(), counters.end(),
+            [&](const ReplicaCounter& existing) { return existing.replica == entry.replica; });
+        if (counter == counters.end())
+        {
+            counter = counters.insert(counters.end(), { entry.replica, 0, 0 });
+        }
+
+        long long addedIncrements = std::max(0LL, entry.increments - counter->increments);
+        long long addedDecrements = std::max(0LL, entry.decrements - counter->decrements);
+        counter->increments += addedIncrements;
+        counter->decrements += addedDecrements;
+        player.totals[entry.colour] += addedIncrements - addedDecrements;
+
+        return addedIncrements > 0 || addedDecrements > 0;
+    }
+
+    // Queues the entries recorded since the last save onto the log and the
+    // outbox.
+    void save()
+    {
+        std::string entries = unsaved.str();
+        unsaved.str("");
+        if (entries.empty())
+        {
+            return;
+        }
+
+        for (const std::string& path : { REPLICA_LOG_FILE, REPLICA_OUTBOX_FILE })
+        {
+            FileWrite file;
+            file.path = path;
+            file.mode = APPEND_FILE;
+            file.add(frameTextBlocks(entries));
+            getPersistenceQueue().submit(std::move(file));
+        }
+    }
+
+    void record(const ReplicaEntry& entry)
+    {
+        if (apply(entry))
+        {
+            writeReplicaEntry(unsaved, entry);
+            save();
+        }
+    }
+
+    size_t stateEntryCount() const
+    {
+        size_t count = 0;
+        for (const auto& [name, player] : players)
+        {
+            count += player.liveTags.size() + player.removedTags.size();
+            for (const std::vector<ReplicaCounter>& counters : player.counters)
+            {
+                count += counters.size();
+            }
+        }
+
+        return count;
+    }
+
+    void writeState(std::ostream& out) const
+    {
+        for (const std::string& name : nameOrder)
+        {
+            const ReplicatedPlayer& player = players.at(name);
+            for (const ReplicaTag& tag : player.liveTags)
+            {
+                writeReplicaEntry(out, { 'A', name, tag.replica, tag.counter });
+            }
+            for (const ReplicaTag& tag : player.removedTags)
+            {
+                writeReplicaEntry(out, { 'R', name, tag.replica, tag.counter });
+            }
+            for (int colour = 0; colour < 5; colour++)
+            {
+                for (const ReplicaCounter& counter : player.counters[colour])
+                {
+                    ReplicaEntry entry;
+                    entry.type = 'C';
+                    entry.name = name;
+                    entry.colour = colour;
+                    entry.replica = counter.replica;
+                    entry.increments = counter.increments;
+                    entry.decrements = counter.decrements;
+                    writeReplicaEntry(out, entry);
+                }
+            }
+        }
+    }
+
+    // Replaces the log with its header and, when compacting, the state.
+    void writeLog(bool withState)
+    {
+        std::ostringstream header;
+        std::ostringstream state;
+        header << REPLICA_LOG_HEADER << ' ' << std::hex << replica << std::dec << '\n';
+        if (withState)
+        {
+            writeState(state);
+        }
+
+        FileWrite file;
+        file.path = REPLICA_LOG_FILE;
+        file.add(header.str());
+        file.add(frameTextBlocks(state.str()));
+        getPersistenceQueue().submit(std::move(file));
+    }
+
+    uint64_t replica = 0;
+    uint64_t clock = 0;
+    std::unordered_map<std::string, ReplicatedPlayer> players;
+    std::vector<std::string> nameOrder;
+    std::unordered_set<ReplicaTag, ReplicaTagHash> removed;
+    std::ostringstream unsaved;
+};
+
+// Keeps playerList in step with the replica during a --replica session.
+// push() turns whatever the last command changed into replica operations:
+// adds, removes and per-colour chip deltas.
+class ReplicaSync
+{
+public:
+    explicit ReplicaSync(ReplicatedLedger& ledger)
+        : ledger(ledger)
+    {
+    }
+
+    // Makes playerList match the replica. A brand new replica takes its
+    // roster from players.txt instead, on the first push. Returns whether the
+    // roster changed.
+    bool pull()
+    {
+        if (ledger.names().empty())
+        {
+            synced.clear();
+            return false;
+        }
+
+        bool rosterChanged = false;
+        auto firstRemoved = std::stable_partition(playerList.begin() + 1, playerList.end(),
+            [&](const Player& player) { return ledger.contains(player.name); });
+        for (auto player = firstRemoved; player != playerList.end(); ++player)
+        {
+            unindexPlayerName(player->name);
+            rosterChanged = true;
+        }
+        playerList.erase(firstRemoved, playerList.end());
+
+        for (const std::string& name : ledger.names())
+        {
+            if (ledger.contains(name) && !playerExists(name))
+            {
+                addPlayer(name);
+                rosterChanged = true;
+            }
+        }
+
+        for (int i = 1; i < playerList.size(); i++)
+        {
+            Player& player = playerList[i];
+            std::array<int*, 5> chips = { &player.whiteChips, &player.redChips, &player.blueChips, &player.greenChips, &player.blackChips };
+            for (int colour = 0; colour < 5; colour++)
+            {
+                *chips[colour] = ledgerChips(player.name, colour);
+            }
+        }
+
+        remember();
+        return rosterChanged;
+    }
+
+    // Merges and deletes every delta file in replica.inbox, then brings just
+    // the players they changed up to date in playerList. Deliver files by
+    // renaming them in, or with a leading '.' until they are complete. Returns
+    // the number of files merged.
+    size_t mergeInbox()
+    {
+        std::error_code error;
+        std::vector<std::filesystem::path> deltaPaths;
+
+        for (const auto& item : std::filesystem::directory_iterator(REPLICA_INBOX_DIRECTORY, error))
+        {
+            if (item.is_regular_file(error) && item.path().filename().string().front() != '.')
+            {
+                deltaPaths.push_back(item.path());
+            }
+        }
+        std::sort(deltaPaths.begin(), deltaPaths.end());
+
+        std::vector<std::string> changedNames;
+        for (const std::filesystem::path& deltaPath : deltaPaths)
+        {
+            std::ifstream delta(deltaPath, std::ios::binary);
+            size_t entriesRead = 0;
+            size_t entriesNew = 0;
+
+            if (!ledger.merge(delta, deltaPath.string(), entriesRead, entriesNew, changedNames))
+            {
+                std::cerr << "WARNING: Skipped '" << deltaPath.string() << "', which is not a PokerPal delta." << '\n';
+            }
+
+            delta.close();
+            std::filesystem::remove(deltaPath, error);
+        }
+
+        std::sort(changedNames.begin(), changedNames.end());
+        changedNames.erase(std::unique(changedNames.begin(), changedNames.end()), changedNames.end());
+
+        std::unordered_set<std::string> removedNames;
+        for (const std::string& name : changedNames)
+        {
+            int slot = rosterSlot(name);
+            if (!ledger.contains(name))
+            {
+                if (slot > 0)
+                {
+                    removedNames.insert(name);
+                }
+                synced.erase(name);
+                continue;
+            }
+
+            if (slot < 0)
+            {
+                addPlayer(name);
+                slot = static_cast<int>(playerList.size() - 1);
+            }
+
+            Player& player = playerList[slot];
+            std::array<int*, 5> chips = { &player.whiteChips, &player.redChips, &player.blueChips, &player.greenChips, &player.blackChips };
+            for (int colour = 0; colour < 5; colour++)
+            {
+                *chips[colour] = ledgerChips(name, colour);
+            }
+            synced[name] = { chipsOf(player), slot, pushCount };
+        }
+
+        // Removals close up playerList in one pass, which moves everyone after
+        // the first removed player.
+        if (!removedNames.empty())
+        {
+            auto firstRemoved = std::stable_partition(playerList.begin() + 1, playerList.end(),
+                [&](const Player& player) { return removedNames.count(player.name) == 0; });
+            for (auto player = firstRemoved; player != playerList.end(); ++player)
+            {
+                unindexPlayerName(player->name);
+            }
+            playerList.erase(firstRemoved, playerList.end());
+
+            for (int i = 1; i < playerList.size(); i++)
+            {
+                auto entry = synced.find(playerList[i].name);
+                if (entry != synced.end())
+                {
+                    entry->second.slot = i;
+                }
+            }
+        }
+
+        return deltaPaths.size();
+    }
+
+    // Writes what changed locally since the last pull or push. Entries are
+    // stamped with this push as they are seen, so players gone from
+    // playerList are the ones left with an older stamp.
+    void push()
+    {
+        pushCount++;
+
+        for (int i = 1; i < playerList.size(); i++)
+        {
+            const Player& player = playerList[i];
+            std::array<int, 5> chips = chipsOf(player);
+            auto [entry, added] = synced.try_emplace(player.name);
+
+            if (added)
+            {
+                ledger.addPlayer(player.name);
+            }
+            for (int colour = 0; colour < 5; colour++)
+            {
+                long long before = added ? ledger.chips(player.name, colour) : entry->second.chips[colour];
+                if (chips[colour] != before)
+                {
+                    ledger.addChips(player.name, colour, chips[colour] - before);
+                }
+            }
+
+            entry->second.chips = chips;
+            entry->second.slot = i;
+            entry->second.push = pushCount;
+        }
+
+        for (auto entry = synced.begin(); entry != synced.end();)
+        {
+            if (entry->second.push != pushCount)
+            {
+                ledger.removePlayer(entry->first);
+                entry = synced.erase(entry);
+            }
+            else
+            {
+                ++entry;
+            }
+        }
+    }
+
+private:
+    int ledgerChips(const std::string& name, int colour) const
+    {
+        return static_cast<int>(std::clamp<long long>(ledger.chips(name, colour), INT_MIN, INT_MAX));
+    }
+
+    static std::array<int, 5> chipsOf(const Player& player)
+    {
+        return { player.whiteChips, player.redChips, player.blueChips, player.greenChips, player.blackChips };
+    }
+
+    void remember()
+    {
+        synced.clear();
+        for (int i = 1; i < playerList.size(); i++)
+        {
+            synced[playerList[i].name] = { chipsOf(playerList[i]), i, pushCount };
+        }
+    }
+
+    // Where `name` sits in playerList, or -1. The slot remembered at the last
+    // push is checked first; it is only stale when the roster was edited
+    // since, and then the roster is searched.
+    int rosterSlot(const std::string& name) const
+    {
+        auto entry = synced.find(name);
+        if (entry != synced.end() && entry->second.slot < playerList.size() && playerList[entry->second.slot].name == name)
+        {
+            return entry->second.slot;
+        }
+
+        return playerExists(name) ? getPlayerIndex(name) : -1;
+    }
+
+    // What this replica last wrote or read for a player, and where in
+    // playerList it was.
+    struct SyncedPlayer
+    {
+        std::array<int, 5> chips = {};
+        int slot = 0;
+        uint64_t push = 0;
+    };
+
+    ReplicatedLedger& ledger;
+    std::unordered_map<std::string, SyncedPlayer> synced;
+    uint64_t pushCount = 0;
+};
+
+// --replica-export and --replica-full. "-" writes to standard output.
+inline bool runReplicaExport(const std::string& path, bool wholeState)
+{
+    ReplicatedLedger ledger;
+    if (!ledger.open())
+    {
+        return false;
+    }
+
+    std::ostringstream delta;
+    std::ostream& out = path == "-" ? std::cout : delta;
+    std::vector<std::string> claimed;
+    if (wholeState)
+    {
+        ledger.exportState(out);
+    }
+    else
+    {
+        claimed = ledger.claimOutbox();
+        ReplicatedLedger::exportOutbox(out, claimed);
+    }
+
+    bool exported = false;
+    if (path == "-")
+    {
+        exported = static_cast<bool>(out.flush());
+    }
+    else
+    {
+        FileWrite file;
+        file.path = path;
+        file.add(delta.str());
+        getPersistenceQueue().submit(std::move(file));
+        exported = getPersistenceQueue().flush();
+    }
+
+    // Only emptied once the delta is out; otherwise the next export sends it.
+    if (exported)
+    {
+        ReplicatedLedger::releaseOutbox(claimed);
+    }
+    else if (!claimed.empty())
+    {
+        std::cerr << "ERROR: The export failed; its changes will be sent again with the next export." << '\n';
+    }
+
+    return exported;
+}
+
+// --replica-merge. "-" reads standard input. Summaries go to standard error
+// so merges can sit in the middle of a pipe.
+inline bool runReplicaMerge(const std::vector<std::string>& paths)
+{
+    ReplicatedLedger ledger;
+    if (!ledger.open())
+    {
+        return false;
+    }
+
+    bool merged = true;
+    for (const std::string& path : paths)
+    {
+        std::ifstream file;
+        if (path != "-")
+        {
+            file.open(path);
+        }
+
+        std::istream& in = path == "-" ? std::cin : file;
+        size_t entriesRead = 0;
+        size_t entriesNew = 0;
+        std::vector<std::string> changedNames;
+
+        if ((path != "-" && !file.is_open()) || !ledger.merge(in, path, entriesRead, entriesNew, changedNames))
+        {
+            std::cerr << "ERROR: '" << path << "' is not a readable PokerPal delta (stopped after " << entriesRead << " entries)!" << '\n';
+            merged = false;
+            continue;
+        }
+
+        std::cerr << "Merged " << entriesRead << " entries from '" << path << "' (" << entriesNew << " new)." << '\n';
+    }
+
+    return merged;
+}
@@ -0,0 +1,251 @@
+#pragma once
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "PokerPal.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+constexpr size_t ROSTER_TAIL_BYTES = 256;
+
+struct RosterChanges
+{
+    int added = 0;
+    int removed = 0;
+};
+
+// Keeps playerList in step with edits other programs make to players.txt.
+// On Linux the file's directory is watched with inotify (editors often
+// replace the file rather than write it), and the menu polls between
+// commands. Elsewhere the watcher never reports a change.
+//
+// The watcher remembers the size and last bytes of the file it last synced
+// with. If the file has grown and still holds those bytes where they were,
+// the edit is taken as an append and only the new names are read, so a
+// registration costs the same however large the roster is. Any other edit
+// is diffed in full against the names the file held last time, not against
+// playerList, so players added this session or by another front-end are
+// never removed just because the file does not list them yet. Only names
+// that actually came or went are touched, and everyone else keeps their
+// chips.
+class RosterWatcher
+{
+public:
+    RosterWatcher() = default;
+    RosterWatcher(const RosterWatcher&) = delete;
+    RosterWatcher& operator=(const RosterWatcher&) = delete;
+
+    ~RosterWatcher()
+    {
+#ifdef __linux__
+        if (descriptor >= 0)
+        {
+            close(descriptor);
+        }
+#endif
+    }
+
+    bool start(const std::string& rosterPath)
+    {
+        path = std::filesystem::absolute(rosterPath);
+        rememberFile();
+
+        std::ifstream file(path, std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::vector<std::string> names = splitNames(text);
+        syncedNames = std::unordered_set<std::string>(names.begin(), names.end());
+
+#ifdef __linux__
+        descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (descriptor < 0 || inotify_add_watch(descriptor, path.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            std::cerr << "WARNING: Unable to watch '" << path.filename().string() << "' for changes." << '\n';
+            return false;
+        }
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Applies any changes written to the roster file since the last call.
+    RosterChanges poll()
+    {
+        RosterChanges changes;
+        if (!fileEventPending())
+        {
+            return changes;
+        }
+
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            return changes;
+        }
+
+        uintmax_t size = static_cast<uintmax_t>(file.tellg());
+        bool appended = size > syncedSize && readBytes(file, syncedSize - syncedTail.size(), syncedTail.size()) == syncedTail;
+        std::string newText = readBytes(file, appended ? syncedSize : 0, size - (appended ? syncedSize : 0));
+
+        // An append that continues the last line renamed that player, so diff it in full.
+        if (appended && !syncedTail.empty() && syncedTail.back() != '\n' && newText.front() != '\n')
+        {
+            appended = false;
+            newText = readBytes(file, 0, size);
+        }
+
+        std::vector<std::string> names = splitNames(newText);
+        if (!appended && names.empty())
+        {
+            std::cerr << "WARNING: '" << path.filename().string() << "' is empty, keeping the current roster." << '\n';
+            rememberFile();
+            return changes;
+        }
+
+        if (appended)
+        {
+            syncedNames.insert(names.begin(), names.end());
+            changes.added = addMissingPlayers(names);
+        }
+        else
+        {
+            changes = applyFileDiff(names);
+        }
+
+        rememberFile();
+        return changes;
+    }
+
+private:
+    bool fileEventPending()
+    {
+#ifdef __linux__
+        if (descriptor < 0)
+        {
+            return false;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        bool touched = false;
+        ssize_t length;
+
+        while ((length = read(descriptor, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* cursor = buffer; cursor < buffer + length;)
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+                touched |= event->len > 0 && path.filename() == event->name;
+                cursor += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        return touched;
+#else
+        return false;
+#endif
+    }
+
+    static std::string readBytes(std::ifstream& file, uintmax_t offset, uintmax_t count)
+    {
+        std::string bytes(static_cast<size_t>(count), '\0');
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(bytes.data(), static_cast<std::streamsize>(count));
+        bytes.resize(static_cast<size_t>(file.gcount()));
+
+        return bytes;
+    }
+
+    std::vector<std::string> splitNames(const std::string& text) const
+    {
+        std::vector<std::string> names;
+        forEachRosterName(text, [&](std::string_view name) { names.emplace_back(name); });
+
+        return names;
+    }
+
+    static int addMissingPlayers(const std::vector<std::string>& names)
+    {
+        int added = 0;
+        for (const std::string& name : names)
+        {
+            if (name != "NONE" && !playerExists(name))
+            {
+                addPlayer(name);
+                added++;
+            }
+        }
+
+        return added;
+    }
+
+    // Removes the players the last version of the file listed and this one
+    // does not, and adds the ones it newly lists.
+    RosterChanges applyFileDiff(const std::vector<std::string>& names)
+    {
+        RosterChanges changes;
+        std::unordered_set<std::string> fileNames(names.begin(), names.end());
+
+        std::unordered_set<std::string> removedNames;
+        for (const std::string& name : syncedNames)
+        {
+            if (fileNames.count(name) == 0)
+            {
+                removedNames.insert(name);
+            }
+        }
+
+        if (!removedNames.empty())
+        {
+            auto firstRemoved = std::stable_partition(playerList.begin() + 1, playerList.end(),
+                [&](const Player& player) { return removedNames.count(player.name) == 0; });
+
+            for (auto player = firstRemoved; player != playerList.end(); ++player)
+            {
+                unindexPlayerName(player->name);
+                changes.removed++;
+            }
+
+            playerList.erase(firstRemoved, playerList.end());
+        }
+
+        std::vector<std::string> newNames;
+        for (const std::string& name : names)
+        {
+            if (syncedNames.count(name) == 0)
+            {
+                newNames.push_back(name);
+            }
+        }
+        changes.added = addMissingPlayers(newNames);
+
+        syncedNames = std::move(fileNames);
+        return changes;
+    }
+
+    void rememberFile()
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        syncedSize = file.is_open() ? static_cast<uintmax_t>(file.tellg()) : 0;
+        syncedTail = file.is_open() ? readBytes(file, syncedSize - std::min<uintmax_t>(syncedSize, ROSTER_TAIL_BYTES),
+            std::min<uintmax_t>(syncedSize, ROSTER_TAIL_BYTES)) : "";
+    }
+
+    std::filesystem::path path;
+    uintmax_t syncedSize = 0;
+    std::string syncedTail;
+    std::unordered_set<std::string> syncedNames;
+#ifdef __linux__
+    int descriptor = -1;
+#endif
+};
@@ -0,0 +1,509 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Checksum.h"
+#include "Leaderboard.h"
+#include "Persistence.h"
+#include "PokerPal.h"
+#include "Tracing.h"
+
+const std::string SESSION_STORE_DIRECTORY = "sessions";
+constexpr size_t LEADERBOARD_TOP_COUNT = 10;
+
+// The session store is a directory of append-only column files:
+//
+//   names.txt          one player name per line, the line number is the id
+//   sessions.col       one SessionRecord per night
+//   result_players.col uint32_t player id per result row
+//   result_chips.col   int32_t[5] white..black chip counts per result row
+//   result_cents.col   int64_t winnings per result row
+//   session_crcs.col   uint32_t CRC32C per night of its SessionRecord and rows
+//
+// Result rows are appended before their session record, so a session only
+// exists once all its rows are on disk. Rows past the last session are left
+// over from an interrupted write and are cut off before the next append. If
+// a row write failed but its session record was still written, the sessions
+// missing rows are dropped the same way.
+//
+// names.txt is framed into checksummed blocks, one per night. A name that
+// fails its checksum keeps its id but cannot be looked up, and a night that
+// fails its checksum is skipped.
+
+enum ReconciliationOutcome : uint8_t { POT_NOT_SET, POT_BALANCED, WINNINGS_OVER_POT, WINNINGS_UNDER_POT };
+
+struct SessionRecord
+{
+    uint32_t date; // yyyymmdd
+    uint8_t outcome;
+    uint8_t reserved[3];
+    int64_t potCents;
+    int64_t totalCents;
+    uint64_t firstResult;
+    uint64_t resultCount;
+};
+
+inline ReconciliationOutcome reconcilePot(long long potCents, long long totalCents)
+{
+    if (potCents == 0)
+    {
+        return POT_NOT_SET;
+    }
+
+    return totalCents > potCents ? WINNINGS_OVER_POT : totalCents < potCents ? WINNINGS_UNDER_POT : POT_BALANCED;
+}
+
+inline uint32_t getTodaysDate()
+{
+    std::time_t now = std::time(nullptr);
+    std::tm local = *std::localtime(&now);
+    return static_cast<uint32_t>((local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday);
+}
+
+// Parses yyyy-mm-dd, returning 0 if the text is not a date.
+inline uint32_t parseIsoDate(const std::string& text)
+{
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-')
+    {
+        return 0;
+    }
+
+    uint32_t date = 0;
+    for (char c : text)
+    {
+        if (c == '-')
+        {
+            continue;
+        }
+        if (c < '0' || c > '9')
+        {
+            return 0;
+        }
+
+        date = date * 10 + (c - '0');
+    }
+
+    return date;
+}
+
+// Prefix sums with O(log n) appends, point updates and prefix queries.
+class FenwickTree
+{
+public:
+    size_t size() const { return tree.size(); }
+
+    void append(long long value)
+    {
+        // Node i covers (i - lowbit(i), i], the tail of which is already summed.
+        size_t node = tree.size() + 1;
+        size_t coveredFrom = node - (node & (~node + 1));
+        tree.push_back(value + prefixSum(node - 1) - prefixSum(coveredFrom));
+    }
+
+    void add(size_t index, long long delta)
+    {
+        for (size_t node = index + 1; node <= tree.size(); node += node & (~node + 1))
+        {
+            tree[node - 1] += delta;
+        }
+    }
+
+    // Sum of the first `count` values.
+    long long prefixSum(size_t count) const
+    {
+        long long sum = 0;
+        for (size_t node = count; node > 0; node -= node & (~node + 1))
+        {
+            sum += tree[node - 1];
+        }
+
+        return sum;
+    }
+
+private:
+    std::vector<long long> tree;
+};
+
+class SessionStore
+{
+public:
+    bool open(const std::string& storeDirectory)
+    {
+        directory = storeDirectory;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error)
+        {
+            std::cerr << "ERROR: Unable to create session store '" << directory << "'!" << '\n';
+            return false;
+        }
+
+        loadNames();
+        histories.resize(names.size());
+        sessions = readColumn<SessionRecord>("sessions.col", SIZE_MAX);
+
+        std::vector<uint32_t> resultPlayers = readColumn<uint32_t>("result_players.col", SIZE_MAX);
+        std::vector<int32_t> resultChips = readColumn<int32_t>("result_chips.col", SIZE_MAX);
+        std::vector<int64_t> resultCents = readColumn<int64_t>("result_cents.col", SIZE_MAX);
+        std::vector<uint32_t> checksums = readColumn<uint32_t>("session_crcs.col", sessions.size());
+
+        // Keep the sessions whose checksum and rows all made it to disk.
+        uint64_t rowCount = std::min<uint64_t>({ resultPlayers.size(), resultChips.size() / 5, resultCents.size() });
+        size_t intactSessions = std::min(sessions.size(), checksums.size());
+        while (intactSessions > 0 && !rowsPresent(sessions[intactSessions - 1], rowCount))
+        {
+            intactSessions--;
+        }
+
+        if (intactSessions < sessions.size())
+        {
+            std::cerr << "WARNING: Dropped " << sessions.size() - intactSessions << " session(s) missing result rows in '"
+                << directory << "'." << '\n';
+            sessions.resize(intactSessions);
+        }
+
+        size_t corruptSessions = 0;
+        size_t corruptRows = 0;
+        for (size_t s = 0; s < sessions.size(); s++)
+        {
+            const SessionRecord& session = sessions[s];
+            if (!rowsPresent(session, rowCount)
+                || sessionChecksum(session, std::span(resultPlayers).subspan(session.firstResult, session.resultCount),
+                    std::span(resultChips).subspan(session.firstResult * 5, session.resultCount * 5),
+                    std::span(resultCents).subspan(session.firstResult, session.resultCount)) != checksums[s])
+            {
+                corruptSessions++;
+                continue;
+            }
+
+            for (uint64_t row = session.firstResult; row < session.firstResult + session.resultCount; row++)
+            {
+                if (resultPlayers[row] >= histories.size())
+                {
+                    corruptRows++;
+                    continue;
+                }
+
+                indexResult(resultPlayers[row], session.date, resultCents[row]);
+            }
+        }
+
+        if (corruptSessions > 0)
+        {
+            std::cerr << "WARNING: Skipped " << corruptSessions << " corrupt session(s) in '" << directory << "'." << '\n';
+        }
+        if (corruptRows > 0)
+        {
+            std::cerr << "WARNING: Skipped " << corruptRows << " result row(s) for unknown players in '" << directory << "'." << '\n';
+        }
+
+        for (uint32_t id = 0; id < histories.size(); id++)
+        {
+            if (!histories[id].dates.empty())
+            {
+                standings.update(id, histories[id].winnings.prefixSum(histories[id].winnings.size()));
+            }
+        }
+
+        opened = true;
+        return true;
+    }
+
+    // Appends tonight's chip counts for the players who played: those whose
+    // chips were entered, or who hold chips synced from another front-end.
+    // Anyone absent gets no row, so their sessions played and standing stay
+    // as they were.
+    bool recordSession(uint32_t date, long long potCents)
+    {
+        TRACE_SPAN("recordSession");
+        if (!opened)
+        {
+            std::cerr << "ERROR: Unable to save session to '" << directory << "'!" << '\n';
+            return false;
+        }
+
+        SessionRecord session = {};
+        session.date = date;
+        session.potCents = potCents;
+        session.firstResult = sessions.empty() ? 0 : sessions.back().firstResult + sessions.back().resultCount;
+
+        std::vector<uint32_t> resultPlayers;
+        std::vector<int32_t> resultChips;
+        std::vector<int64_t> resultCents;
+        std::string newNames;
+
+        for (int i = 1; i < playerList.size(); i++)
+        {
+            const Player& player = playerList[i];
+            if (!player.chipsEntered && calculateWinningsCents(player) == 0)
+            {
+                continue;
+            }
+
+            auto [id, added] = ids.try_emplace(player.name, static_cast<uint32_t>(names.size()));
+            if (added)
+            {
+                names.push_back(player.name);
+                histories.emplace_back();
+                newNames.append(player.name).append("\n");
+            }
+
+            long long cents = calculateWinningsCents(player);
+            resultPlayers.push_back(id->second);
+            resultChips.insert(resultChips.end(),
+                { player.whiteChips, player.redChips, player.blueChips, player.greenChips, player.blackChips });
+            resultCents.push_back(cents);
+            session.totalCents += cents;
+        }
+
+        session.resultCount = resultPlayers.size();
+        session.outcome = reconcilePot(potCents, session.totalCents);
+
+        std::error_code error;
+        if (!std::filesystem::is_directory(directory, error))
+        {
+            std::cerr << "ERROR: Unable to save session to '" << directory << "'!" << '\n';
+            return false;
+        }
+
+        if (!newNames.empty())
+        {
+            FileWrite namesFile;
+            namesFile.path = columnPath("names.txt");
+            namesFile.mode = APPEND_FILE;
+            namesFile.add(frameTextBlocks(newNames, SIZE_MAX));
+            getPersistenceQueue().submit(std::move(namesFile));
+        }
+
+        // sessions.col goes last: a row only counts once its session does.
+        std::vector<uint32_t> checksum = { sessionChecksum(session, resultPlayers, resultChips, resultCents) };
+        appendColumn("result_players.col", session.firstResult * sizeof(uint32_t), resultPlayers);
+        appendColumn("result_chips.col", session.firstResult * 5 * sizeof(int32_t), resultChips);
+        appendColumn("result_cents.col", session.firstResult * sizeof(int64_t), resultCents);
+        appendColumn("session_crcs.col", sessions.size() * sizeof(uint32_t), checksum);
+        appendColumn("sessions.col", sessions.size() * sizeof(SessionRecord), std::vector<SessionRecord>{ session });
+
+        sessions.push_back(session);
+        for (size_t r = 0; r < resultPlayers.size(); r++)
+        {
+            indexResult(resultPlayers[r], date, resultCents[r]);
+            standings.update(resultPlayers[r], standings.winningsCents(resultPlayers[r]) + resultCents[r]);
+        }
+
+        return true;
+    }
+
+    size_t sessionCount() const { return sessions.size(); }
+    const Leaderboard& leaderboard() const { return standings; }
+    const std::string& playerName(uint32_t playerId) const { return names[playerId]; }
+
+    // Returns the store's id for a player, or -1 if they have no sessions.
+    long long findPlayerId(const std::string& name) const
+    {
+        auto id = ids.find(name);
+        return id == ids.end() ? -1 : static_cast<long long>(id->second);
+    }
+
+    long long lifetimeCents(const std::string& name) const
+    {
+        auto id = ids.find(name);
+        return id == ids.end() ? 0 : histories[id->second].winnings.prefixSum(histories[id->second].winnings.size());
+    }
+
+    // Winnings over sessions dated fromDate..toDate inclusive (yyyymmdd).
+    long long rangeCents(const std::string& name, uint32_t fromDate, uint32_t toDate) const
+    {
+        auto id = ids.find(name);
+        if (id == ids.end())
+        {
+            return 0;
+        }
+
+        const PlayerHistory& history = histories[id->second];
+        size_t from = std::lower_bound(history.dates.begin(), history.dates.end(), fromDate) - history.dates.begin();
+        size_t to = std::upper_bound(history.dates.begin(), history.dates.end(), toDate) - history.dates.begin();
+
+        return to > from ? history.winnings.prefixSum(to) - history.winnings.prefixSum(from) : 0;
+    }
+
+    int sessionsPlayed(const std::string& name) const
+    {
+        auto id = ids.find(name);
+        return id == ids.end() ? 0 : static_cast<int>(histories[id->second].dates.size());
+    }
+
+private:
+    // Each player's sessions in the order they were recorded, which is also
+    // date order, so date ranges map to a range of Fenwick positions.
+    struct PlayerHistory
+    {
+        std::vector<uint32_t> dates;
+        FenwickTree winnings;
+    };
+
+    void indexResult(uint32_t playerId, uint32_t date, long long cents)
+    {
+        histories[playerId].dates.push_back(date);
+        histories[playerId].winnings.append(cents);
+    }
+
+    // Reads names.txt, cutting off a block left half-written by an
+    // interrupted save; no session can refer to the names in it.
+    void loadNames()
+    {
+        std::ifstream namesFile(columnPath("names.txt"), std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(namesFile)), std::istreambuf_iterator<char>());
+
+        TextBlockScan scan = readTextBlocks(text, columnPath("names.txt"), [&](std::string_view name, bool intact)
+        {
+            if (intact)
+            {
+                ids[std::string(name)] = static_cast<uint32_t>(names.size());
+            }
+            names.emplace_back(intact ? name : std::string_view());
+        });
+
+        if (scan.tornTail)
+        {
+            std::string_view tail = std::string_view(text).substr(scan.framedBytes);
+            size_t tornNames = std::count(tail.begin(), tail.end(), '\n') + (tail.back() != '\n');
+            names.resize(names.size() - tornNames);
+
+            FileWrite cut;
+            cut.path = columnPath("names.txt");
+            cut.mode = WRITE_FILE_AT;
+            cut.offset = scan.framedBytes;
+            getPersistenceQueue().submit(std::move(cut));
+        }
+    }
+
+    static bool rowsPresent(const SessionRecord& session, uint64_t rowCount)
+    {
+        return session.firstResult <= rowCount && session.resultCount <= rowCount - session.firstResult;
+    }
+
+    // The checksum of a night's record and its own result rows.
+    static uint32_t sessionChecksum(const SessionRecord& session, std::span<const uint32_t> players,
+        std::span<const int32_t> chips, std::span<const int64_t> cents)
+    {
+        uint32_t crc = crc32c(&session, sizeof(session));
+        crc = crc32c(players.data(), players.size_bytes(), crc);
+        crc = crc32c(chips.data(), chips.size_bytes(), crc);
+        return crc32c(cents.data(), cents.size_bytes(), crc);
+    }
+
+    std::string columnPath(const std::string& column) const
+    {
+        return (std::filesystem::path(directory) / column).string();
+    }
+
+    template <typename T>
+    std::vector<T> readColumn(const std::string& column, uint64_t maxCount) const
+    {
+        std::ifstream file(columnPath(column), std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            return {};
+        }
+
+        uint64_t count = std::min<uint64_t>(maxCount, static_cast<uint64_t>(file.tellg()) / sizeof(T));
+        std::vector<T> values(count);
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+
+        return values;
+    }
+
+    // Drops anything past committedBytes before appending. The write is
+    // queued; the persistence queue reports it if it fails.
+    template <typename T>
+    void appendColumn(const std::string& column, uint64_t committedBytes, const std::vector<T>& values) const
+    {
+        FileWrite file;
+        file.path = columnPath(column);
+        file.mode = WRITE_FILE_AT;
+        file.offset = committedBytes;
+        file.add(values.data(), values.size() * sizeof(T));
+        getPersistenceQueue().submit(std::move(file));
+    }
+
+    std::string directory;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<PlayerHistory> histories;
+    std::vector<SessionRecord> sessions;
+    Leaderboard standings;
+    bool opened = false; // nothing is written to a store that failed to open
+};
+
+inline SessionStore& getSessionStore()
+{
+    static SessionStore store = []()
+    {
+        SessionStore sessions;
+        sessions.open(SESSION_STORE_DIRECTORY);
+        return sessions;
+    }();
+
+    return store;
+}
+
+// Handles "--winnings <name> [from yyyy-mm-dd] [to yyyy-mm-dd]".
+inline int runWinningsQuery(const std::string& name, const std::string& from, const std::string& to)
+{
+    const SessionStore& store = getSessionStore();
+    uint32_t fromDate = from.empty() ? 0 : parseIsoDate(from);
+    uint32_t toDate = to.empty() ? UINT32_MAX : parseIsoDate(to);
+
+    if ((fromDate == 0 && !from.empty()) || toDate == 0)
+    {
+        std::cerr << "ERROR: Dates must be in yyyy-mm-dd format!" << '\n';
+        return 1;
+    }
+
+    std::cout << name << ": $" << store.rangeCents(name, fromDate, toDate) / 100.0 << " ($"
+        << store.lifetimeCents(name) / 100.0 << " lifetime over " << store.sessionsPlayed(name) << " sessions)" << '\n';
+
+    return 0;
+}
+
+// Prints the top of the season standings, then where tonight's players sit.
+inline void printLeaderboard(size_t topCount)
+{
+    TRACE_SPAN("printLeaderboard");
+    const SessionStore& store = getSessionStore();
+    const Leaderboard& standings = store.leaderboard();
+
+    if (standings.size() == 0)
+    {
+        std::cerr << "WARNING: No sessions have been recorded yet." << '\n';
+        return;
+    }
+
+    size_t position = 1;
+    standings.forEachTop(topCount, [&](uint32_t playerId, long long cents)
+    {
+        std::cout << position++ << ". " << store.playerName(playerId) << ": $" << cents / 100.0 << '\n';
+    });
+
+    std::cout << '\n';
+    for (int i = 1; i < playerList.size(); i++)
+    {
+        long long playerId = store.findPlayerId(playerList[i].name);
+        if (playerId >= 0)
+        {
+            std::cout << playerList[i].name << " is ranked " << standings.rank(static_cast<uint32_t>(playerId)) << " of "
+                << standings.size() << " (" << standings.percentile(static_cast<uint32_t>(playerId)) << " percentile)" << '\n';
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "Parallel.h"
+
+constexpr size_t COUNTERS_PER_LINE = 8; // long longs per 64-byte cache line
+
+// Each thread gets the next shard in turn the first time it asks, so the
+// workers of one parallelFor land on different shards.
+inline size_t currentShard(size_t shardCount)
+{
+    static std::atomic<size_t> nextShard(0);
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed);
+
+    return shard % shardCount;
+}
+
+// A total that many threads add to at once. Every worker adds into its own
+// cache line with a relaxed atomic, so adds never contend, and value() sums
+// the lines. fold() moves the lines into a base so folded() can answer from
+// one load, at most one fold behind. fold() and both reads belong to one
+// reading thread.
+class ShardedCounter
+{
+public:
+    explicit ShardedCounter(size_t shardCount = getWorkerCount())
+        : shards(shardCount)
+    {
+    }
+
+    void add(long long delta)
+    {
+        shards[currentShard(shards.size())].value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    long long value() const
+    {
+        long long total = base;
+        for (const Shard& shard : shards)
+        {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+
+        return total;
+    }
+
+    long long folded() const { return base; }
+
+    void fold()
+    {
+        for (Shard& shard : shards)
+        {
+            base += shard.value.exchange(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<long long> value{ 0 };
+    };
+
+    std::vector<Shard> shards;
+    long long base = 0;
+};
+
+// One ShardedCounter per player, in cents. Each shard is a row of counters
+// for every player, starting on its own cache line, so two workers only
+// ever share a line when they share a shard.
+class ShardedChipLedger
+{
+public:
+    explicit ShardedChipLedger(size_t playerCount, size_t shardCount = getWorkerCount())
+        : lineCount((playerCount + COUNTERS_PER_LINE - 1) / COUNTERS_PER_LINE), shardCount(shardCount),
+        lines(lineCount * shardCount), base(playerCount, 0)
+    {
+    }
+
+    void add(size_t player, long long cents)
+    {
+        counter(currentShard(shardCount), player).fetch_add(cents, std::memory_order_relaxed);
+    }
+
+    long long winningsCents(size_t player) const
+    {
+        long long total = base[player];
+        for (size_t shard = 0; shard < shardCount; shard++)
+        {
+            total += counter(shard, player).load(std::memory_order_relaxed);
+        }
+
+        return total;
+    }
+
+    long long foldedCents(size_t player) const { return base[player]; }
+
+    void fold()
+    {
+        for (size_t shard = 0; shard < shardCount; shard++)
+        {
+            for (size_t player = 0; player < base.size(); player++)
+            {
+                base[player] += counter(shard, player).exchange(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) CounterLine
+    {
+        std::atomic<long long> values[COUNTERS_PER_LINE] = {};
+    };
+
+    std::atomic<long long>& counter(size_t shard, size_t player)
+    {
+        return lines[shard * lineCount + player / COUNTERS_PER_LINE].values[player % COUNTERS_PER_LINE];
+    }
+
+    const std::atomic<long long>& counter(size_t shard, size_t player) const
+    {
+        return lines[shard * lineCount + player / COUNTERS_PER_LINE].values[player % COUNTERS_PER_LINE];
+    }
+
+    size_t lineCount;
+    size_t shardCount;
+    std::vector<CounterLine> lines;
+    std::vector<long long> base;
+};
@@ -0,0 +1,594 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "PokerPal.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const std::string DEFAULT_SHARED_LEDGER = "/pokerpal";
+
+constexpr uint32_t SHARED_LEDGER_MAGIC = 0x4C535050; // "PPSL"
+constexpr uint32_t SHARED_LEDGER_LAYOUT = 1;
+constexpr uint32_t SHARED_LEDGER_CAPACITY = 4096;                       // players, including removed ones
+constexpr uint32_t SHARED_LEDGER_SLOTS = 2 * SHARED_LEDGER_CAPACITY;    // name index, a power of two
+constexpr size_t SHARED_NAME_LENGTH = 31;
+constexpr int SHARED_LEDGER_ATTACH_TRIES = 200;                         // 5ms apart
+constexpr int SHARED_READ_SPINS = 1024;                                 // before checking for a dead writer
+
+#ifdef __linux__
+
+// One player's chips. Readers never lock: they retry while `sequence` is odd
+// or changes under them (a seqlock), so a read is a handful of loads from
+// memory every attached process shares. Writers take `writeLock`, a robust
+// process-shared mutex, so a writer that dies mid-update cannot wedge the
+// record; a reader that keeps finding the sequence odd checks the lock for
+// a dead owner itself rather than waiting for the next write.
+struct alignas(64) SharedPlayerRecord
+{
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> active; // 0 once removed; the name keeps its record
+    std::array<std::atomic<int32_t>, 5> chips;
+    char name[SHARED_NAME_LENGTH + 1];
+    pthread_mutex_t writeLock;
+};
+
+struct SharedLedgerHeader
+{
+    std::atomic<uint32_t> magic; // set last, once the creator has initialised everything
+    uint32_t layout;
+    std::atomic<uint32_t> recordCount;
+    std::atomic<uint32_t> rosterVersion; // bumped by every add and remove
+    std::atomic<long long> potCents;
+    pthread_mutex_t rosterLock;          // serialises adds and removes
+    std::atomic<uint32_t> slots[SHARED_LEDGER_SLOTS]; // record index + 1, or 0 when empty
+};
+
+// Roster and chip counts in a POSIX shared-memory segment, so several
+// PokerPal processes on one host see the same live state. Names are only ever
+// appended to the name index, so lookups are lock-free too. The segment
+// outlives the processes; delete it from /dev/shm to start a fresh one.
+class SharedLedger
+{
+public:
+    SharedLedger() = default;
+    SharedLedger(const SharedLedger&) = delete;
+    SharedLedger& operator=(const SharedLedger&) = delete;
+
+    ~SharedLedger()
+    {
+        if (header != nullptr)
+        {
+            munmap(header, segmentSize());
+        }
+    }
+
+    // Attaches to the named segment, creating it from `roster` (laid out like
+    // playerList) if no process has yet.
+    bool open(const std::string& name, const std::vector<Player>& roster)
+    {
+        int descriptor = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+        bool creator = descriptor >= 0;
+
+        if (!creator && errno == EEXIST)
+        {
+            descriptor = shm_open(name.c_str(), O_RDWR, 0);
+        }
+        if (descriptor < 0 || (creator && ftruncate(descriptor, segmentSize()) != 0))
+        {
+            std::cerr << "ERROR: Unable to open shared ledger '" << name << "': " << std::strerror(errno) << '\n';
+            if (descriptor >= 0)
+            {
+                close(descriptor);
+            }
+            return false;
+        }
+
+        // The creator may not have sized the segment yet.
+        struct stat status{};
+        for (int tries = 0; fstat(descriptor, &status) == 0 && static_cast<size_t>(status.st_size) < segmentSize()
+            && tries < SHARED_LEDGER_ATTACH_TRIES; tries++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        void* mapping = static_cast<size_t>(status.st_size) < segmentSize() ? MAP_FAILED
+            : mmap(nullptr, segmentSize(), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        close(descriptor);
+
+        if (mapping == MAP_FAILED)
+        {
+            std::cerr << "ERROR: Unable to map shared ledger '" << name << "'!" << '\n';
+            return false;
+        }
+
+        header = static_cast<SharedLedgerHeader*>(mapping);
+        records = reinterpret_cast<SharedPlayerRecord*>(static_cast<char*>(mapping) + recordsOffset());
+
+        if (creator)
+        {
+            initialise(roster);
+            return true;
+        }
+
+        for (int tries = 0; header->magic.load(std::memory_order_acquire) != SHARED_LEDGER_MAGIC
+            && tries < SHARED_LEDGER_ATTACH_TRIES; tries++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (header->magic.load(std::memory_order_acquire) != SHARED_LEDGER_MAGIC || header->layout != SHARED_LEDGER_LAYOUT)
+        {
+            std::cerr << "ERROR: '" << name << "' is not a PokerPal shared ledger of this version!" << '\n';
+            return false;
+        }
+
+        return true;
+    }
+
+    uint32_t recordCount() const { return header->recordCount.load(std::memory_order_acquire); }
+    uint32_t rosterVersion() const { return header->rosterVersion.load(std::memory_order_acquire); }
+    bool isActive(uint32_t index) const { return records[index].active.load(std::memory_order_acquire) != 0; }
+    const char* name(uint32_t index) const { return records[index].name; }
+
+    long long potCents() const { return header->potCents.load(std::memory_order_relaxed); }
+    void setPotCents(long long cents) { header->potCents.store(cents, std::memory_order_relaxed); }
+
+    // The record holding `name`, removed or not, or -1.
+    long long findPlayer(std::string_view name) const
+    {
+        for (uint32_t slot = hashName(name);; slot = (slot + 1) & (SHARED_LEDGER_SLOTS - 1))
+        {
+            uint32_t entry = header->slots[slot].load(std::memory_order_acquire);
+            if (entry == 0)
+            {
+                return -1;
+            }
+            if (name == records[entry - 1].name)
+            {
+                return entry - 1;
+            }
+        }
+    }
+
+    void readChips(uint32_t index, Player& player) const
+    {
+        SharedPlayerRecord& record = records[index];
+        std::array<int32_t, 5> chips;
+        uint32_t before;
+
+        for (int tries = 1;; tries++)
+        {
+            before = record.sequence.load(std::memory_order_acquire);
+            for (int color = 0; color < 5; color++)
+            {
+                chips[color] = record.chips[color].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if ((before & 1) == 0 && record.sequence.load(std::memory_order_relaxed) == before)
+            {
+                break;
+            }
+            if (tries % SHARED_READ_SPINS == 0)
+            {
+                repairStalledRecord(record);
+            }
+        }
+
+        player.whiteChips = chips[0];
+        player.redChips = chips[1];
+        player.blueChips = chips[2];
+        player.greenChips = chips[3];
+        player.blackChips = chips[4];
+    }
+
+    void writeChips(uint32_t index, const Player& player)
+    {
+        SharedPlayerRecord& record = records[index];
+        lockRecord(record);
+        storeChips(record, { player.whiteChips, player.redChips, player.blueChips, player.greenChips, player.blackChips });
+        pthread_mutex_unlock(&record.writeLock);
+    }
+
+    // Players from the roster this process created the ledger from that did
+    // not fit in it.
+    const std::vector<std::string>& rejected() const { return rejectedNames; }
+
+    // Whether addPlayer would take `name`, saying why not if it would not.
+    bool admits(const std::string& name) const
+    {
+        if (name.size() > SHARED_NAME_LENGTH)
+        {
+            std::cerr << "ERROR: Shared ledger names are limited to " << SHARED_NAME_LENGTH << " characters!" << '\n';
+            return false;
+        }
+        if (findPlayer(name) < 0 && recordCount() >= SHARED_LEDGER_CAPACITY)
+        {
+            std::cerr << "ERROR: The shared ledger is full (" << SHARED_LEDGER_CAPACITY << " players)!" << '\n';
+            return false;
+        }
+
+        return true;
+    }
+
+    // Adds `name` (or brings a removed player back) with no chips. Returns
+    // its record, or -1 if the name is too long or the ledger is full.
+    long long addPlayer(const std::string& name)
+    {
+        if (!admits(name))
+        {
+            return -1;
+        }
+
+        lockRoster();
+        long long index = findPlayer(name);
+
+        if (index < 0 && recordCount() < SHARED_LEDGER_CAPACITY)
+        {
+            index = header->recordCount.load(std::memory_order_relaxed);
+            SharedPlayerRecord& record = records[index];
+            std::memcpy(record.name, name.c_str(), name.size() + 1);
+
+            // Counted first and indexed second, so a crash in between leaves a
+            // record that recoverRoster() can index.
+            header->recordCount.store(static_cast<uint32_t>(index + 1), std::memory_order_release);
+            indexRecord(static_cast<uint32_t>(index));
+        }
+
+        if (index >= 0)
+        {
+            SharedPlayerRecord& record = records[index];
+            lockRecord(record);
+            storeChips(record, { 0, 0, 0, 0, 0 });
+            record.active.store(1, std::memory_order_release);
+            pthread_mutex_unlock(&record.writeLock);
+            header->rosterVersion.fetch_add(1, std::memory_order_release);
+        }
+        else
+        {
+            std::cerr << "ERROR: The shared ledger is full (" << SHARED_LEDGER_CAPACITY << " players)!" << '\n';
+        }
+
+        pthread_mutex_unlock(&header->rosterLock);
+        return index;
+    }
+
+    void removePlayer(uint32_t index)
+    {
+        lockRoster();
+        records[index].active.store(0, std::memory_order_release);
+        header->rosterVersion.fetch_add(1, std::memory_order_release);
+        pthread_mutex_unlock(&header->rosterLock);
+    }
+
+private:
+    static constexpr size_t recordsOffset()
+    {
+        return (sizeof(SharedLedgerHeader) + alignof(SharedPlayerRecord) - 1) / alignof(SharedPlayerRecord)
+            * alignof(SharedPlayerRecord);
+    }
+
+    static constexpr size_t segmentSize()
+    {
+        return recordsOffset() + SHARED_LEDGER_CAPACITY * sizeof(SharedPlayerRecord);
+    }
+
+    static uint32_t hashName(std::string_view name)
+    {
+        uint32_t hash = 2166136261u; // FNV-1a
+        for (char c : name)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        }
+
+        return hash & (SHARED_LEDGER_SLOTS - 1);
+    }
+
+    static void initialiseMutex(pthread_mutex_t& mutex)
+    {
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+    }
+
+    // A fresh segment is all zeroes, which is already an empty ledger apart
+    // from the mutexes.
+    void initialise(const std::vector<Player>& roster)
+    {
+        header->layout = SHARED_LEDGER_LAYOUT;
+        initialiseMutex(header->rosterLock);
+        for (uint32_t i = 0; i < SHARED_LEDGER_CAPACITY; i++)
+        {
+            initialiseMutex(records[i].writeLock);
+        }
+
+        header->magic.store(SHARED_LEDGER_MAGIC, std::memory_order_release);
+
+        for (size_t i = 1; i < roster.size(); i++)
+        {
+            long long index = addPlayer(roster[i].name);
+            if (index >= 0)
+            {
+                writeChips(static_cast<uint32_t>(index), roster[i]);
+            }
+            else
+            {
+                rejectedNames.push_back(roster[i].name);
+            }
+        }
+    }
+
+    void indexRecord(uint32_t index)
+    {
+        uint32_t slot = hashName(records[index].name);
+        while (header->slots[slot].load(std::memory_order_relaxed) != 0)
+        {
+            slot = (slot + 1) & (SHARED_LEDGER_SLOTS - 1);
+        }
+
+        header->slots[slot].store(index + 1, std::memory_order_release);
+    }
+
+    static void storeChips(SharedPlayerRecord& record, const std::array<int32_t, 5>& chips)
+    {
+        uint32_t sequence = record.sequence.load(std::memory_order_relaxed);
+        record.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int color = 0; color < 5; color++)
+        {
+            record.chips[color].store(chips[color], std::memory_order_relaxed);
+        }
+
+        record.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // A writer that died holding the lock may have left the sequence odd,
+    // which would spin readers forever. Its partial update is kept, since
+    // each chip count on its own is whole.
+    static void closeSequence(SharedPlayerRecord& record)
+    {
+        uint32_t sequence = record.sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) != 0)
+        {
+            record.sequence.store(sequence + 1, std::memory_order_release);
+        }
+    }
+
+    static void lockRecord(SharedPlayerRecord& record)
+    {
+        if (pthread_mutex_lock(&record.writeLock) == EOWNERDEAD)
+        {
+            closeSequence(record);
+            pthread_mutex_consistent(&record.writeLock);
+            std::cerr << "WARNING: Recovered " << record.name << "'s chips after a PokerPal process crashed mid-update." << '\n';
+        }
+    }
+
+    // Called by a reader that has seen the sequence stay odd. If the lock is
+    // free, or its owner died, no write is in progress and the sequence is
+    // closed; if a live writer holds it, the reader just yields to it.
+    static void repairStalledRecord(SharedPlayerRecord& record)
+    {
+        int locked = pthread_mutex_trylock(&record.writeLock);
+        if (locked == EBUSY)
+        {
+            std::this_thread::yield();
+            return;
+        }
+
+        if ((record.sequence.load(std::memory_order_relaxed) & 1) != 0)
+        {
+            closeSequence(record);
+            std::cerr << "WARNING: Recovered " << record.name << "'s chips after a PokerPal process crashed mid-update." << '\n';
+        }
+        if (locked == EOWNERDEAD)
+        {
+            pthread_mutex_consistent(&record.writeLock);
+        }
+        if (locked == 0 || locked == EOWNERDEAD)
+        {
+            pthread_mutex_unlock(&record.writeLock);
+        }
+    }
+
+    void lockRoster()
+    {
+        if (pthread_mutex_lock(&header->rosterLock) == EOWNERDEAD)
+        {
+            recoverRoster();
+            pthread_mutex_consistent(&header->rosterLock);
+            std::cerr << "WARNING: Recovered the shared roster after a PokerPal process crashed mid-update." << '\n';
+        }
+    }
+
+    // Indexes a record that was counted but never indexed.
+    void recoverRoster()
+    {
+        uint32_t count = header->recordCount.load(std::memory_order_relaxed);
+        if (count > 0 && findPlayer(records[count - 1].name) < 0)
+        {
+            indexRecord(count - 1);
+        }
+        header->rosterVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    SharedLedgerHeader* header = nullptr;
+    SharedPlayerRecord* records = nullptr;
+    std::vector<std::string> rejectedNames;
+};
+
+// Keeps this process's playerList and pot in step with a shared ledger. pull()
+// brings in everything other processes changed; push() writes back only what
+// this process changed since its last pull, so two front-ends editing
+// different players never overwrite each other. A local player the ledger
+// cannot hold (a name reaching here from players.txt or a replica) is
+// reported once and kept locally.
+class SharedLedgerSync
+{
+public:
+    explicit SharedLedgerSync(SharedLedger& ledger)
+        : ledger(ledger), unshared(ledger.rejected().begin(), ledger.rejected().end())
+    {
+    }
+
+    void pull()
+    {
+        if (ledger.rosterVersion() != pulledRosterVersion || pulled.empty())
+        {
+            pullRoster();
+        }
+
+        for (int i = 1; i < playerList.size(); i++)
+        {
+            long long index = ledger.findPlayer(playerList[i].name);
+            if (index >= 0)
+            {
+                ledger.readChips(static_cast<uint32_t>(index), playerList[i]);
+                pulled[playerList[i].name] = chipsOf(playerList[i]);
+            }
+        }
+
+        pulledPotCents = ledger.potCents();
+        setPotCents(pulledPotCents);
+    }
+
+    void push()
+    {
+        std::unordered_set<std::string> localNames;
+
+        for (int i = 1; i < playerList.size(); i++)
+        {
+            const Player& player = playerList[i];
+            localNames.insert(player.name);
+            auto previous = pulled.find(player.name);
+
+            if (previous == pulled.end() && unshared.count(player.name) == 0)
+            {
+                long long index = ledger.addPlayer(player.name);
+                if (index >= 0)
+                {
+                    ledger.writeChips(static_cast<uint32_t>(index), player);
+                }
+                else
+                {
+                    unshared.insert(player.name);
+                }
+            }
+            else if (previous != pulled.end() && previous->second != chipsOf(player))
+            {
+                ledger.writeChips(static_cast<uint32_t>(ledger.findPlayer(player.name)), player);
+            }
+        }
+
+        for (const auto& [name, chips] : pulled)
+        {
+            if (localNames.count(name) == 0)
+            {
+                ledger.removePlayer(static_cast<uint32_t>(ledger.findPlayer(name)));
+            }
+        }
+
+        long long potCents = getPotCents();
+        if (potCents != pulledPotCents)
+        {
+            ledger.setPotCents(potCents);
+        }
+    }
+
+private:
+    static std::array<int, 5> chipsOf(const Player& player)
+    {
+        return { player.whiteChips, player.redChips, player.blueChips, player.greenChips, player.blackChips };
+    }
+
+    // Adds and removes local players to match the shared roster, keeping
+    // local order for everyone who stays. Names too long to ever be shared
+    // stay too; push() reports them.
+    void pullRoster()
+    {
+        pulledRosterVersion = ledger.rosterVersion();
+        pulled.clear();
+
+        std::unordered_set<std::string> sharedNames;
+        for (uint32_t index = 0; index < ledger.recordCount(); index++)
+        {
+            if (ledger.isActive(index))
+            {
+                sharedNames.insert(ledger.name(index));
+            }
+        }
+
+        auto firstRemoved = std::stable_partition(playerList.begin() + 1, playerList.end(),
+            [&](const Player& player)
+            {
+                return sharedNames.count(player.name) > 0 || unshared.count(player.name) > 0
+                    || player.name.size() > SHARED_NAME_LENGTH;
+            });
+        for (auto player = firstRemoved; player != playerList.end(); ++player)
+        {
+            unindexPlayerName(player->name);
+        }
+        playerList.erase(firstRemoved, playerList.end());
+
+        for (uint32_t index = 0; index < ledger.recordCount(); index++)
+        {
+            if (ledger.isActive(index) && !playerExists(ledger.name(index)))
+            {
+                addPlayer(ledger.name(index));
+            }
+        }
+    }
+
+    SharedLedger& ledger;
+    std::unordered_map<std::string, std::array<int, 5>> pulled;
+    std::unordered_set<std::string> unshared;
+    uint32_t pulledRosterVersion = 0;
+    long long pulledPotCents = 0;
+};
+
+#else
+
+class SharedLedger
+{
+public:
+    bool open(const std::string& name, const std::vector<Player>&)
+    {
+        std::cerr << "ERROR: Shared ledgers need Linux (POSIX shared memory and robust mutexes)." << '\n';
+        return false;
+    }
+
+    bool admits(const std::string&) const { return true; }
+};
+
+class SharedLedgerSync
+{
+public:
+    explicit SharedLedgerSync(SharedLedger&) {}
+    void pull() {}
+    void push() {}
+};
+
+#endif
@@ -0,0 +1,541 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Cards.h"
+#include "Parallel.h"
+#include "PokerPal.h"
+#include "ShardedCounter.h"
+
+constexpr int MAX_TABLE_SEATS = 9;
+constexpr long long DEFAULT_BUY_IN_CENTS = 1025; // matches the default pot of $10.25 per player
+constexpr long long SIMULATION_SMALL_BLIND_CENTS = 5;
+constexpr long long SIMULATION_BIG_BLIND_CENTS = 10;
+constexpr long long SIMULATION_ANTE_CENTS = 1;
+constexpr auto SIMULATION_PROGRESS_INTERVAL = std::chrono::seconds(1);
+constexpr long long SIMULATION_POST_HANDS = 64; // hands a table plays between posts to the live ledger
+
+enum BettingRound { PREFLOP, FLOP, TURN, RIVER };
+
+enum SimulatedActionType { FOLD, CHECK_OR_CALL, BET_OR_RAISE };
+
+struct SimulatedAction
+{
+    SimulatedActionType type;
+    long long raiseTo; // total street bet after a bet or raise
+};
+
+// Everything a strategy may look at when it is asked to act.
+struct DecisionContext
+{
+    uint64_t holeCards;
+    uint64_t board;
+    BettingRound round;
+    long long pot;
+    long long toCall;
+    long long minRaiseTo;
+    long long streetBet;
+    long long stack;
+    int playersInHand;
+    FastRng* rng;
+};
+
+// Strategies are plain function pointers so seating them costs nothing per hand.
+using SimulationStrategy = SimulatedAction (*)(const DecisionContext&);
+
+inline SimulatedAction callingStationStrategy(const DecisionContext&)
+{
+    return { CHECK_OR_CALL, 0 };
+}
+
+// Bets the pot preflop with pocket pairs and ace-ten or better, and after the
+// flop with two pair or better. Otherwise checks or folds.
+inline SimulatedAction valueBettingStrategy(const DecisionContext& context)
+{
+    uint32_t score = evaluateHand(context.holeCards | context.board);
+    int category = static_cast<int>(score >> 26);
+    bool strong;
+
+    if (context.round == PREFLOP)
+    {
+        strong = category == ONE_PAIR || (score & RANK_MASK) >= ((1u << 12) | (1u << 8));
+    }
+    else
+    {
+        strong = category >= TWO_PAIR;
+    }
+
+    if (strong)
+    {
+        return { BET_OR_RAISE, context.streetBet + context.toCall + context.pot };
+    }
+
+    return { context.toCall == 0 ? CHECK_OR_CALL : FOLD, 0 };
+}
+
+inline SimulatedAction randomStrategy(const DecisionContext& context)
+{
+    uint32_t roll = context.rng->bounded(10);
+
+    if (roll < 2)
+    {
+        return { FOLD, 0 };
+    }
+    if (roll < 8)
+    {
+        return { CHECK_OR_CALL, 0 };
+    }
+
+    return { BET_OR_RAISE, context.minRaiseTo };
+}
+
+const SimulationStrategy SIMULATION_STRATEGIES[] = { callingStationStrategy, valueBettingStrategy, randomStrategy };
+
+// One table of seated players. Stacks are integer cents so chips are never
+// lost to rounding, and every hand runs out of fixed-size arrays.
+struct SimulatedTable
+{
+    int seatCount = 0;
+    int button = 0;
+    long long handsPlayed = 0;
+    std::array<Player*, MAX_TABLE_SEATS> players{};
+    std::array<long long, MAX_TABLE_SEATS> stacks{};
+    std::array<SimulationStrategy, MAX_TABLE_SEATS> strategies{};
+};
+
+// Live totals of a running simulation. Each table posts its pots and every
+// seat's change in chips every SIMULATION_POST_HANDS hands, and runSimulation
+// folds the shards once per progress report and reads the folded values.
+struct SimulationLedger
+{
+    ShardedCounter hands;
+    ShardedCounter potCents;
+    ShardedChipLedger winnings; // indexed like playerList
+
+    explicit SimulationLedger(size_t playerCount)
+        : winnings(playerCount)
+    {
+    }
+};
+
+class HandSimulator
+{
+public:
+    HandSimulator(SimulatedTable& table, uint64_t seed)
+        : table(table), rng(seed)
+    {
+        for (int card = 0; card < DECK_SIZE; card++)
+        {
+            deck[card] = static_cast<uint8_t>(card);
+        }
+    }
+
+    // Plays one hand. Returns false once fewer than two players have chips.
+    bool playHand()
+    {
+        const int seatCount = table.seatCount;
+        int seatsWithChips = 0;
+
+        for (int seat = 0; seat < seatCount; seat++)
+        {
+            committed[seat] = 0;
+            streetBet[seat] = 0;
+            allIn[seat] = false;
+            folded[seat] = table.stacks[seat] == 0;
+            seatsWithChips += folded[seat] ? 0 : 1;
+        }
+
+        if (seatsWithChips < 2)
+        {
+            return false;
+        }
+
+        // Partial Fisher-Yates: only the cards this hand can use are shuffled.
+        const int cardsNeeded = 2 * seatCount + 5;
+        for (int i = 0; i < cardsNeeded; i++)
+        {
+            int j = i + static_cast<int>(rng.bounded(DECK_SIZE - i));
+            std::swap(deck[i], deck[j]);
+        }
+
+        for (int seat = 0; seat < seatCount; seat++)
+        {
+            holeCards[seat] = cardMask(deck[2 * seat]) | cardMask(deck[2 * seat + 1]);
+        }
+
+        uint64_t streetBoards[4];
+        streetBoards[PREFLOP] = 0;
+        streetBoards[FLOP] = cardMask(deck[2 * seatCount]) | cardMask(deck[2 * seatCount + 1]) | cardMask(deck[2 * seatCount + 2]);
+        streetBoards[TURN] = streetBoards[FLOP] | cardMask(deck[2 * seatCount + 3]);
+        streetBoards[RIVER] = streetBoards[TURN] | cardMask(deck[2 * seatCount + 4]);
+
+        table.button = nextSeatWithChips(table.button);
+        int smallBlind = seatsWithChips == 2 ? table.button : nextSeatWithChips(table.button);
+        int bigBlind = nextSeatWithChips(smallBlind);
+
+        playersInHand = seatsWithChips;
+        pot = 0;
+
+        for (int seat = 0; seat < seatCount; seat++)
+        {
+            if (!folded[seat])
+            {
+                putChips(seat, SIMULATION_ANTE_CENTS);
+                streetBet[seat] = 0; // antes are dead money, not part of the street bet
+            }
+        }
+
+        putChips(smallBlind, SIMULATION_SMALL_BLIND_CENTS);
+        putChips(bigBlind, SIMULATION_BIG_BLIND_CENTS);
+
+        for (int round = PREFLOP; round <= RIVER && playersInHand > 1; round++)
+        {
+            if (round != PREFLOP)
+            {
+                for (int seat = 0; seat < seatCount; seat++)
+                {
+                    streetBet[seat] = 0;
+                }
+            }
+
+            int firstToAct = round == PREFLOP ? nextSeatWithChips(bigBlind) : nextSeatWithChips(table.button);
+            playBettingRound(static_cast<BettingRound>(round), streetBoards[round], firstToAct);
+        }
+
+        settlePot(streetBoards[RIVER]);
+        table.handsPlayed++;
+
+        return true;
+    }
+
+    long long lastPot() const { return pot; }
+
+private:
+    int nextSeatWithChips(int seat) const
+    {
+        do
+        {
+            seat = (seat + 1) % table.seatCount;
+        } while (table.stacks[seat] == 0 && committed[seat] == 0);
+
+        return seat;
+    }
+
+    bool canAct(int seat) const
+    {
+        return !folded[seat] && !allIn[seat];
+    }
+
+    int countCanAct() const
+    {
+        int count = 0;
+        for (int seat = 0; seat < table.seatCount; seat++)
+        {
+            count += canAct(seat) ? 1 : 0;
+        }
+
+        return count;
+    }
+
+    void putChips(int seat, long long amount)
+    {
+        amount = std::min(amount, table.stacks[seat]);
+        table.stacks[seat] -= amount;
+        committed[seat] += amount;
+        streetBet[seat] += amount;
+        pot += amount;
+        allIn[seat] = table.stacks[seat] == 0;
+    }
+
+    void playBettingRound(BettingRound round, uint64_t board, int firstToAct)
+    {
+        long long currentBet = 0;
+        for (int seat = 0; seat < table.seatCount; seat++)
+        {
+            currentBet = std::max(currentBet, streetBet[seat]);
+        }
+
+        long long minRaise = SIMULATION_BIG_BLIND_CENTS;
+        int playersToAct = countCanAct();
+        int seat = firstToAct;
+
+        // Nobody is left to bet against, so the board just runs out.
+        if (playersToAct == 1)
+        {
+            for (int other = 0; other < table.seatCount; other++)
+            {
+                if (canAct(other) && streetBet[other] >= currentBet)
+                {
+                    return;
+                }
+            }
+        }
+
+        while (playersToAct > 0 && playersInHand > 1)
+        {
+            if (canAct(seat))
+            {
+                long long toCall = currentBet - streetBet[seat];
+                DecisionContext context = { holeCards[seat], board, round, pot, toCall, currentBet + minRaise,
+                    streetBet[seat], table.stacks[seat], playersInHand, &rng };
+                SimulatedAction action = table.strategies[seat](context);
+
+                if (action.type == FOLD && toCall > 0)
+                {
+                    folded[seat] = true;
+                    playersInHand--;
+                    playersToAct--;
+                }
+                else if (action.type == BET_OR_RAISE && table.stacks[seat] > toCall && countCanAct() > 1)
+                {
+                    long long raiseTo = std::max(action.raiseTo, currentBet + minRaise);
+                    raiseTo = std::min(raiseTo, streetBet[seat] + table.stacks[seat]);
+
+                    putChips(seat, raiseTo - streetBet[seat]);
+                    minRaise = std::max(minRaise, raiseTo - currentBet);
+                    currentBet = raiseTo;
+
+                    // Everyone else still able to act must respond to the raise.
+                    playersToAct = countCanAct() - (canAct(seat) ? 1 : 0);
+                }
+                else
+                {
+                    putChips(seat, toCall);
+                    playersToAct--;
+                }
+            }
+
+            seat = (seat + 1) % table.seatCount;
+        }
+    }
+
+    // Splits the pot into a main pot and side pots at each all-in level and
+    // awards each to the best eligible hand. Odd cents go to the first winner
+    // left of the button.
+    void settlePot(uint64_t board)
+    {
+        const int seatCount = table.seatCount;
+        std::array<long long, MAX_TABLE_SEATS> levels;
+        std::array<uint32_t, MAX_TABLE_SEATS> scores;
+        int levelCount = 0;
+
+        for (int seat = 0; seat < seatCount; seat++)
+        {
+            if (!folded[seat])
+            {
+                levels[levelCount++] = committed[seat];
+                scores[seat] = playersInHand > 1 ? evaluateHand(holeCards[seat] | board) : 0;
+            }
+        }
+
+        std::sort(levels.begin(), levels.begin() + levelCount);
+
+        long long previousLevel = 0;
+        for (int l = 0; l < levelCount; l++)
+        {
+            if (l + 1 < levelCount && levels[l] == levels[l + 1])
+            {
+                continue;
+            }
+
+            // The top pot also sweeps up anything folded players put in above it.
+            bool topPot = l == levelCount - 1;
+            long long slice = 0;
+            for (int seat = 0; seat < seatCount; seat++)
+            {
+                long long upper = topPot ? committed[seat] : std::min(committed[seat], levels[l]);
+                slice += std::max(0LL, upper - std::min(committed[seat], previousLevel));
+            }
+
+            uint32_t bestScore = 0;
+            int winnerCount = 0;
+            for (int seat = 0; seat < seatCount; seat++)
+            {
+                if (!folded[seat] && committed[seat] >= levels[l])
+                {
+                    if (winnerCount == 0 || scores[seat] > bestScore)
+                    {
+                        bestScore = scores[seat];
+                        winnerCount = 1;
+                    }
+                    else if (scores[seat] == bestScore)
+                    {
+                        winnerCount++;
+                    }
+                }
+            }
+
+            long long share = slice / winnerCount;
+            long long oddChips = slice % winnerCount;
+
+            for (int offset = 1; offset <= seatCount; offset++)
+            {
+                int seat = (table.button + offset) % seatCount;
+                if (!folded[seat] && committed[seat] >= levels[l] && scores[seat] == bestScore)
+                {
+                    table.stacks[seat] += share + (oddChips > 0 ? 1 : 0);
+                    oddChips--;
+                }
+            }
+
+            previousLevel = levels[l];
+        }
+    }
+
+    SimulatedTable& table;
+    FastRng rng;
+    std::array<uint8_t, DECK_SIZE> deck;
+    std::array<uint64_t, MAX_TABLE_SEATS> holeCards;
+    std::array<long long, MAX_TABLE_SEATS> committed;
+    std::array<long long, MAX_TABLE_SEATS> streetBet;
+    std::array<bool, MAX_TABLE_SEATS> folded;
+    std::array<bool, MAX_TABLE_SEATS> allIn;
+    long long pot = 0;
+    int playersInHand = 0;
+};
+
+// One line on a simulation still in progress, with its biggest winner so far.
+inline void printSimulationProgress(SimulationLedger& ledger)
+{
+    ledger.hands.fold();
+    ledger.potCents.fold();
+    ledger.winnings.fold();
+
+    size_t leader = 1;
+    for (size_t i = 2; i < playerList.size(); i++)
+    {
+        leader = ledger.winnings.foldedCents(i) > ledger.winnings.foldedCents(leader) ? i : leader;
+    }
+
+    std::cout << "  " << ledger.hands.folded() << " hands, $" << ledger.potCents.folded() / 100.0 << " in pots";
+    if (leader < playerList.size())
+    {
+        std::cout << ", leader " << playerList[leader].name << " ($" << ledger.winnings.foldedCents(leader) / 100.0 << ")";
+    }
+    std::cout << '\n';
+    std::cout.flush();
+}
+
+// Seats every loaded player (buying in players without chips for the default
+// amount), plays up to `handsPerTable` hands at each table in parallel and
+// writes the final stacks back to the players' chip counts.
+inline long long runSimulation(long long handsPerTable, uint64_t seed)
+{
+    std::vector<Player*> seatedPlayers;
+    for (int i = 1; i < playerList.size(); i++)
+    {
+        seatedPlayers.push_back(&playerList[i]);
+    }
+
+    int tableCount = static_cast<int>((seatedPlayers.size() + MAX_TABLE_SEATS - 1) / MAX_TABLE_SEATS);
+    std::vector<SimulatedTable> tables(tableCount);
+    long long chipsBefore = 0;
+
+    for (size_t i = 0; i < seatedPlayers.size(); i++)
+    {
+        SimulatedTable& table = tables[i % tableCount];
+        long long stack = calculateWinningsCents(*seatedPlayers[i]);
+        stack = stack > 0 ? stack : DEFAULT_BUY_IN_CENTS;
+
+        table.players[table.seatCount] = seatedPlayers[i];
+        table.stacks[table.seatCount] = stack;
+        table.strategies[table.seatCount] = SIMULATION_STRATEGIES[i % std::size(SIMULATION_STRATEGIES)];
+        table.seatCount++;
+        chipsBefore += stack;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SimulationLedger ledger(playerList.size());
+    std::mutex finishedMutex;
+    std::condition_variable finishedSignal;
+    bool finished = false;
+
+    std::thread workers([&]()
+    {
+        parallelFor(tables.size(), [&](size_t t)
+        {
+            SimulatedTable& table = tables[t];
+            HandSimulator simulator(table, seed + t);
+            std::array<long long, MAX_TABLE_SEATS> postedStacks = table.stacks;
+            long long unpostedHands = 0;
+            long long unpostedPots = 0;
+
+            auto post = [&]()
+            {
+                ledger.hands.add(unpostedHands);
+                ledger.potCents.add(unpostedPots);
+                unpostedHands = 0;
+                unpostedPots = 0;
+
+                for (int seat = 0; seat < table.seatCount; seat++)
+                {
+                    if (table.stacks[seat] != postedStacks[seat])
+                    {
+                        ledger.winnings.add(table.players[seat] - playerList.data(), table.stacks[seat] - postedStacks[seat]);
+                        postedStacks[seat] = table.stacks[seat];
+                    }
+                }
+            };
+
+            for (long long hand = 0; hand < handsPerTable && simulator.playHand(); hand++)
+            {
+                unpostedHands++;
+                unpostedPots += simulator.lastPot();
+                if (unpostedHands == SIMULATION_POST_HANDS)
+                {
+                    post();
+                }
+            }
+            post();
+        });
+
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finished = true;
+        finishedSignal.notify_one();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(finishedMutex);
+        auto nextReport = start + SIMULATION_PROGRESS_INTERVAL;
+
+        while (!finishedSignal.wait_until(lock, nextReport, [&]() { return finished; }))
+        {
+            printSimulationProgress(ledger);
+            nextReport += SIMULATION_PROGRESS_INTERVAL;
+        }
+    }
+    workers.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    long long handsPlayed = 0;
+    long long chipsAfter = 0;
+
+    for (const SimulatedTable& table : tables)
+    {
+        handsPlayed += table.handsPlayed;
+        for (int seat = 0; seat < table.seatCount; seat++)
+        {
+            setChipsFromCents(*table.players[seat], table.stacks[seat]);
+            chipsAfter += calculateWinningsCents(*table.players[seat]);
+        }
+    }
+
+    std::cout << "Simulated " << handsPlayed << " hands at " << tableCount << " tables in " << elapsed.count()
+        << "s (" << static_cast<long long>(handsPlayed / std::max(elapsed.count(), 1e-9)) << " hands/s, $"
+        << ledger.potCents.value() / 100.0 << " in pots)" << '\n';
+
+    if (chipsBefore != chipsAfter)
+    {
+        std::cerr << "ERROR: Chip total changed from $" << chipsBefore / 100.0 << " to $" << chipsAfter / 100.0
+            << " during the simulation!" << '\n';
+    }
+
+    return handsPlayed;
+}
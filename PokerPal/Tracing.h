@@ -0,0 +1,177 @@
+#pragma once
+
+// Build with POKERPAL_TRACING defined to record a span for every TRACE_SPAN
+// scope and write them to pokerpal-trace.json on exit, in the Chrome trace
+// event format (open it in chrome://tracing or ui.perfetto.dev). Without the
+// define, TRACE_SPAN compiles to nothing.
+//
+// Each thread records into its own ring of TRACE_RING_EVENTS spans, so a
+// span costs two timestamp reads and one store with no locking; when a ring
+// wraps, its oldest spans are dropped. Timestamps are raw TSC ticks on
+// x86-64, converted to microseconds against the steady clock on export.
+#ifdef POKERPAL_TRACING
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define POKERPAL_TRACE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+constexpr size_t TRACE_RING_EVENTS = 1 << 16; // per thread, a power of two
+
+const std::string TRACE_FILE = "pokerpal-trace.json";
+
+inline uint64_t traceTimestamp()
+{
+#ifdef POKERPAL_TRACE_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// Written only by its own thread. Rings are never freed, so the spans of
+// threads that have finished are still there to export.
+struct TraceRing
+{
+    std::unique_ptr<TraceEvent[]> events = std::make_unique<TraceEvent[]>(TRACE_RING_EVENTS);
+    std::atomic<uint64_t> recorded{ 0 };
+    uint32_t threadId = 0;
+    TraceRing* next = nullptr;
+};
+
+// The first timestamp, paired with the steady clock so ticks can be turned
+// into time.
+struct TraceClock
+{
+    uint64_t startTicks = traceTimestamp();
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+};
+
+struct TraceRegistry
+{
+    std::atomic<TraceRing*> rings{ nullptr };
+    std::atomic<uint32_t> threadCount{ 0 };
+    TraceClock clock;
+};
+
+inline TraceRegistry& getTraceRegistry()
+{
+    static TraceRegistry registry;
+    return registry;
+}
+
+inline TraceRing& getThreadTraceRing()
+{
+    thread_local TraceRing* ring = nullptr;
+    if (ring == nullptr)
+    {
+        TraceRegistry& registry = getTraceRegistry();
+        ring = new TraceRing();
+        ring->threadId = ++registry.threadCount;
+        ring->next = registry.rings.load();
+        while (!registry.rings.compare_exchange_weak(ring->next, ring))
+        {
+        }
+    }
+
+    return *ring;
+}
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name)
+        : name(name), begin(traceTimestamp())
+    {
+    }
+
+    ~TraceSpan()
+    {
+        uint64_t end = traceTimestamp();
+        TraceRing& ring = getThreadTraceRing();
+        uint64_t index = ring.recorded.load(std::memory_order_relaxed);
+        ring.events[index & (TRACE_RING_EVENTS - 1)] = { name, begin, end };
+        ring.recorded.store(index + 1, std::memory_order_release);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    uint64_t begin;
+};
+
+// Writes every ring as complete ("X") events. Meant for exit, once the other
+// threads have stopped recording.
+inline void exportTrace()
+{
+    TraceRegistry& registry = getTraceRegistry();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - registry.clock.startTime;
+    uint64_t elapsedTicks = traceTimestamp() - registry.clock.startTicks;
+    double microsecondsPerTick = elapsedTicks == 0 ? 0.0 : elapsed.count() / elapsedTicks;
+
+    std::ofstream trace(TRACE_FILE, std::ios::binary);
+    if (!trace.is_open())
+    {
+        std::cerr << "ERROR: Unable to write '" << TRACE_FILE << "'!" << '\n';
+        return;
+    }
+
+    trace.setf(std::ios::fixed);
+    trace.precision(3);
+    trace << "{\"traceEvents\":[";
+
+    size_t spanCount = 0;
+    size_t droppedCount = 0;
+    for (TraceRing* ring = registry.rings.load(); ring != nullptr; ring = ring->next)
+    {
+        uint64_t recorded = ring->recorded.load(std::memory_order_acquire);
+        uint64_t first = recorded > TRACE_RING_EVENTS ? recorded - TRACE_RING_EVENTS : 0;
+        droppedCount += first;
+
+        for (uint64_t i = first; i < recorded; i++)
+        {
+            const TraceEvent& event = ring->events[i & (TRACE_RING_EVENTS - 1)];
+            double start = static_cast<double>(event.begin - std::min(event.begin, registry.clock.startTicks)) * microsecondsPerTick;
+
+            trace << (spanCount++ == 0 ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << ring->threadId << ",\"ts\":" << start << ",\"dur\":" << (event.end - event.begin) * microsecondsPerTick << "}";
+        }
+    }
+    trace << "\n]}\n";
+
+    std::cerr << "Wrote " << spanCount << " spans to '" << TRACE_FILE << "'";
+    if (droppedCount > 0)
+    {
+        std::cerr << " (" << droppedCount << " older spans dropped)";
+    }
+    std::cerr << "." << '\n';
+}
+
+inline const bool traceExportRegistered = (getTraceRegistry(), std::atexit(exportTrace), true);
+
+#define TRACE_SPAN(name) TraceSpan traceSpan(name)
+#else
+#define TRACE_SPAN(name)
+#endif
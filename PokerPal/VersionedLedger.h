@@ -0,0 +1,238 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "PokerPal.h"
+
+constexpr size_t LEDGER_CHUNK_SIZE = 64;
+constexpr size_t MAX_LEDGER_READERS = 64;
+
+struct LedgerChunk
+{
+    uint64_t version; // the working version that created it
+    std::array<Player, LEDGER_CHUNK_SIZE> players;
+};
+
+struct LedgerVersion
+{
+    size_t size = 0;
+    std::vector<LedgerChunk*> chunks;
+};
+
+// A pinned, read-only view of the ledger as it was when published. Safe to
+// read from any thread; the chunks it sees stay alive until it is destroyed.
+class LedgerSnapshot
+{
+public:
+    LedgerSnapshot() = default;
+    LedgerSnapshot(const LedgerSnapshot&) = delete;
+    LedgerSnapshot& operator=(const LedgerSnapshot&) = delete;
+
+    LedgerSnapshot(LedgerSnapshot&& other) noexcept
+        : slot(std::exchange(other.slot, nullptr)), version(std::exchange(other.version, nullptr))
+    {
+    }
+
+    LedgerSnapshot& operator=(LedgerSnapshot&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            slot = std::exchange(other.slot, nullptr);
+            version = std::exchange(other.version, nullptr);
+        }
+
+        return *this;
+    }
+
+    ~LedgerSnapshot()
+    {
+        release();
+    }
+
+    size_t size() const { return version == nullptr ? 0 : version->size; }
+
+    const Player& operator[](size_t index) const
+    {
+        return version->chunks[index / LEDGER_CHUNK_SIZE]->players[index % LEDGER_CHUNK_SIZE];
+    }
+
+private:
+    friend class VersionedLedger;
+
+    LedgerSnapshot(std::atomic<uint64_t>* slot, const LedgerVersion* version)
+        : slot(slot), version(version)
+    {
+    }
+
+    void release()
+    {
+        if (slot != nullptr)
+        {
+            slot->store(0, std::memory_order_release);
+            slot = nullptr;
+        }
+    }
+
+    std::atomic<uint64_t>* slot = nullptr;
+    const LedgerVersion* version = nullptr;
+};
+
+// Multi-version store of the roster's Player entries, one per slot. One
+// writer thread edits a private working version in place and publishes it
+// when readers need a consistent view; any thread can then pin the latest
+// published version with snapshot().
+//
+// Entries live in fixed-size chunks shared between versions. After a publish
+// the first write to a chunk copies it (copy on write), so writers never wait
+// for readers and pay at most one chunk copy per chunk per publish. A chunk
+// replaced that way is retired with the current epoch and freed once every
+// reader pinned at or before that epoch has let go (epoch-based reclamation).
+class VersionedLedger
+{
+public:
+    VersionedLedger()
+    {
+        published.store(new LedgerVersion());
+    }
+
+    VersionedLedger(const VersionedLedger&) = delete;
+    VersionedLedger& operator=(const VersionedLedger&) = delete;
+
+    // Every snapshot must be gone by now.
+    ~VersionedLedger()
+    {
+        std::vector<LedgerChunk*> chunks = working.chunks;
+        std::vector<LedgerVersion*> versions = { published.load() };
+        chunks.insert(chunks.end(), superseded.begin(), superseded.end());
+
+        for (Retirement& retirement : retired)
+        {
+            versions.push_back(retirement.version);
+            chunks.insert(chunks.end(), retirement.chunks.begin(), retirement.chunks.end());
+        }
+        for (LedgerVersion* version : versions)
+        {
+            chunks.insert(chunks.end(), version->chunks.begin(), version->chunks.end());
+            delete version;
+        }
+
+        std::sort(chunks.begin(), chunks.end());
+        chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+        for (LedgerChunk* chunk : chunks)
+        {
+            delete chunk;
+        }
+    }
+
+    // The members below belong to the writer thread.
+
+    size_t size() const { return working.size; }
+
+    const Player& operator[](size_t index) const
+    {
+        return working.chunks[index / LEDGER_CHUNK_SIZE]->players[index % LEDGER_CHUNK_SIZE];
+    }
+
+    Player& edit(size_t index)
+    {
+        LedgerChunk*& chunk = working.chunks[index / LEDGER_CHUNK_SIZE];
+        if (chunk->version != workingVersion)
+        {
+            LedgerChunk* copy = new LedgerChunk(*chunk);
+            copy->version = workingVersion;
+            superseded.push_back(chunk);
+            chunk = copy;
+        }
+
+        return chunk->players[index % LEDGER_CHUNK_SIZE];
+    }
+
+    void push_back(const Player& player)
+    {
+        if (working.size % LEDGER_CHUNK_SIZE == 0)
+        {
+            working.chunks.push_back(new LedgerChunk{ workingVersion, {} });
+        }
+
+        edit(working.size++) = player;
+    }
+
+    // Makes the working version visible to snapshot(). Costs one pointer per
+    // chunk, plus freeing whatever no reader can still see.
+    void publish()
+    {
+        LedgerVersion* previous = published.exchange(new LedgerVersion(working));
+        uint64_t epoch = globalEpoch.load();
+
+        retired.push_back({ epoch, previous, std::move(superseded) });
+        superseded.clear();
+        globalEpoch.store(epoch + 1);
+        workingVersion++;
+
+        reclaim();
+    }
+
+    // Frees retired versions and chunks older than every pinned reader.
+    void reclaim()
+    {
+        uint64_t oldestPinned = UINT64_MAX;
+        for (const std::atomic<uint64_t>& readerEpoch : readerEpochs)
+        {
+            uint64_t epoch = readerEpoch.load();
+            oldestPinned = epoch == 0 ? oldestPinned : std::min(oldestPinned, epoch);
+        }
+
+        while (!retired.empty() && retired.front().epoch < oldestPinned)
+        {
+            for (LedgerChunk* chunk : retired.front().chunks)
+            {
+                delete chunk;
+            }
+            delete retired.front().version;
+            retired.pop_front();
+        }
+    }
+
+    // Any thread. The reader's epoch is announced before the published
+    // version is read, so publish() cannot free it underneath.
+    LedgerSnapshot snapshot()
+    {
+        for (;;)
+        {
+            for (std::atomic<uint64_t>& readerEpoch : readerEpochs)
+            {
+                uint64_t idle = 0;
+                if (readerEpoch.compare_exchange_strong(idle, globalEpoch.load()))
+                {
+                    return LedgerSnapshot(&readerEpoch, published.load());
+                }
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Retirement
+    {
+        uint64_t epoch;
+        LedgerVersion* version;
+        std::vector<LedgerChunk*> chunks;
+    };
+
+    LedgerVersion working;
+    uint64_t workingVersion = 1;
+    std::vector<LedgerChunk*> superseded; // replaced since the last publish, still in the published version
+    std::deque<Retirement> retired;
+
+    std::atomic<LedgerVersion*> published;
+    std::atomic<uint64_t> globalEpoch{ 1 };
+    std::array<std::atomic<uint64_t>, MAX_LEDGER_READERS> readerEpochs{}; // 0 while a slot is free
+};
@@ -0,0 +1,217 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "Parallel.h"
+#include "PokerPal.h"
+#include "Tracing.h"
+
+const int REPORT_PERCENTILES[] = { 10, 25, 50, 75, 90, 99 };
+
+struct RankedWinnings
+{
+    long long cents;
+    int playerIndex;
+};
+
+// Cuts the roster (less the NONE entry) into one contiguous range per worker.
+inline size_t getRosterRangeCount()
+{
+    return std::max<size_t>(1, std::min<size_t>(getWorkerCount(), playerList.size() / 4096));
+}
+
+inline int rosterRangeBegin(size_t range, size_t rangeCount)
+{
+    return static_cast<int>(1 + (playerList.size() - 1) * range / rangeCount);
+}
+
+// Keeps the k best players under `ranksAbove` in one pass per range with a
+// bounded heap, then merges the per-range heaps the same way.
+template <typename Compare>
+std::vector<RankedWinnings> selectTopWinnings(size_t k, Compare ranksAbove)
+{
+    // The heap front is the weakest player kept so far.
+    auto offer = [&](std::vector<RankedWinnings>& heap, const RankedWinnings& candidate)
+    {
+        if (heap.size() < k)
+        {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end(), ranksAbove);
+        }
+        else if (k > 0 && ranksAbove(candidate, heap.front()))
+        {
+            std::pop_heap(heap.begin(), heap.end(), ranksAbove);
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end(), ranksAbove);
+        }
+    };
+
+    size_t rangeCount = getRosterRangeCount();
+    std::vector<std::vector<RankedWinnings>> partialHeaps(rangeCount);
+
+    parallelFor(rangeCount, [&](size_t r)
+    {
+        for (int i = rosterRangeBegin(r, rangeCount); i < rosterRangeBegin(r + 1, rangeCount); i++)
+        {
+            offer(partialHeaps[r], { calculateWinningsCents(playerList[i]), i });
+        }
+    });
+
+    std::vector<RankedWinnings> top = std::move(partialHeaps[0]);
+    for (size_t r = 1; r < rangeCount; r++)
+    {
+        for (const RankedWinnings& candidate : partialHeaps[r])
+        {
+            offer(top, candidate);
+        }
+    }
+
+    std::sort_heap(top.begin(), top.end(), ranksAbove);
+    return top;
+}
+
+constexpr int RADIX_DIGIT_BITS = 11;
+constexpr size_t RADIX_BUCKETS = size_t(1) << RADIX_DIGIT_BITS;
+
+// Returns the winnings at each 0-based position of the roster sorted in
+// ascending order. One pass finds the range of winnings, then every position
+// is found together by a radix select over the offsets from the minimum:
+// each pass streams the roster once, adding the next digit of every player
+// to the histogram of whichever position's chosen digits they match, so
+// nothing is copied or sorted. Positions that still share their digits share
+// a histogram. Nightly winnings span a few thousand dollars at most, which
+// is two or three passes however many positions are asked for.
+inline std::vector<long long> selectWinningsAtPositions(const std::vector<size_t>& positions)
+{
+    size_t rangeCount = getRosterRangeCount();
+    std::vector<long long> rangeMinimums(rangeCount, LLONG_MAX);
+    std::vector<long long> rangeMaximums(rangeCount, LLONG_MIN);
+
+    parallelFor(rangeCount, [&](size_t r)
+    {
+        for (int i = rosterRangeBegin(r, rangeCount); i < rosterRangeBegin(r + 1, rangeCount); i++)
+        {
+            long long cents = calculateWinningsCents(playerList[i]);
+            rangeMinimums[r] = std::min(rangeMinimums[r], cents);
+            rangeMaximums[r] = std::max(rangeMaximums[r], cents);
+        }
+    });
+
+    long long minimum = *std::min_element(rangeMinimums.begin(), rangeMinimums.end());
+    long long maximum = *std::max_element(rangeMaximums.begin(), rangeMaximums.end());
+    int keyBits = std::bit_width(static_cast<uint64_t>(maximum - minimum));
+    int topShift = std::max(0, (keyBits - 1) / RADIX_DIGIT_BITS * RADIX_DIGIT_BITS);
+
+    std::vector<uint64_t> prefixes(positions.size(), 0);
+    std::vector<size_t> ranks(positions.begin(), positions.end()); // rank among players matching the prefix
+    std::vector<std::vector<uint32_t>> histograms(rangeCount);
+
+    for (int shift = topShift; shift >= 0 && !positions.empty(); shift -= RADIX_DIGIT_BITS)
+    {
+        uint64_t prefixMask = shift + RADIX_DIGIT_BITS >= 64 ? 0 : ~0ULL << (shift + RADIX_DIGIT_BITS);
+
+        std::vector<uint64_t> groups = prefixes;
+        std::sort(groups.begin(), groups.end());
+        groups.erase(std::unique(groups.begin(), groups.end()), groups.end());
+
+        parallelFor(rangeCount, [&](size_t r)
+        {
+            std::vector<uint32_t>& histogram = histograms[r];
+            histogram.assign(groups.size() * RADIX_BUCKETS, 0);
+
+            for (int i = rosterRangeBegin(r, rangeCount); i < rosterRangeBegin(r + 1, rangeCount); i++)
+            {
+                uint64_t key = static_cast<uint64_t>(calculateWinningsCents(playerList[i]) - minimum);
+                uint64_t keyPrefix = key & prefixMask;
+                for (size_t g = 0; g < groups.size(); g++)
+                {
+                    if (keyPrefix == groups[g])
+                    {
+                        histogram[g * RADIX_BUCKETS + ((key >> shift) & (RADIX_BUCKETS - 1))]++;
+                        break;
+                    }
+                }
+            }
+        });
+
+        for (size_t p = 0; p < positions.size(); p++)
+        {
+            size_t group = std::lower_bound(groups.begin(), groups.end(), prefixes[p]) - groups.begin();
+
+            for (uint64_t digit = 0; digit < RADIX_BUCKETS; digit++)
+            {
+                size_t count = 0;
+                for (const std::vector<uint32_t>& histogram : histograms)
+                {
+                    count += histogram[group * RADIX_BUCKETS + digit];
+                }
+
+                if (ranks[p] < count)
+                {
+                    prefixes[p] |= digit << shift;
+                    break;
+                }
+
+                ranks[p] -= count;
+            }
+        }
+    }
+
+    std::vector<long long> results;
+    for (uint64_t prefix : prefixes)
+    {
+        results.push_back(minimum + static_cast<long long>(prefix));
+    }
+
+    return results;
+}
+
+inline void printTopWinnings(size_t k)
+{
+    TRACE_SPAN("printTopWinnings");
+    auto winnersFirst = [](const RankedWinnings& a, const RankedWinnings& b)
+    {
+        return a.cents > b.cents || (a.cents == b.cents && a.playerIndex < b.playerIndex);
+    };
+    auto losersFirst = [](const RankedWinnings& a, const RankedWinnings& b)
+    {
+        return a.cents < b.cents || (a.cents == b.cents && a.playerIndex < b.playerIndex);
+    };
+
+    std::cout << "Top " << k << " winners:" << '\n';
+    int position = 1;
+    for (const RankedWinnings& player : selectTopWinnings(k, winnersFirst))
+    {
+        std::cout << position++ << ". " << playerList[player.playerIndex].name << ": $" << player.cents / 100.0 << '\n';
+    }
+
+    std::cout << '\n' << "Top " << k << " losers:" << '\n';
+    position = 1;
+    for (const RankedWinnings& player : selectTopWinnings(k, losersFirst))
+    {
+        std::cout << position++ << ". " << playerList[player.playerIndex].name << ": $" << player.cents / 100.0 << '\n';
+    }
+}
+
+inline void printWinningsPercentiles()
+{
+    TRACE_SPAN("printWinningsPercentiles");
+    size_t playerCount = playerList.size() - 1;
+    std::vector<size_t> positions;
+
+    for (int percentile : REPORT_PERCENTILES)
+    {
+        positions.push_back((playerCount - 1) * percentile / 100);
+    }
+
+    std::vector<long long> cutoffs = selectWinningsAtPositions(positions);
+    for (size_t p = 0; p < positions.size(); p++)
+    {
+        std::cout << REPORT_PERCENTILES[p] << "th percentile: $" << cutoffs[p] / 100.0 << '\n';
+    }
+}
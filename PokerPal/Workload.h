@@ -0,0 +1,643 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Cards.h"
+#include "LedgerServer.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+constexpr size_t WORKLOAD_BUFFER_SIZE = 1024 * 1024;
+constexpr size_t REPLAY_WINDOW = 1024;           // commands in flight before the driver waits for replies
+
+// The shape of a generated workload. Chances are in percent.
+struct WorkloadProfile
+{
+    uint64_t seed = 1;
+    uint64_t preloaded = 1;      // players already in players.txt, never named by the stream
+    uint64_t players = 1000;     // roster added before the first night
+    uint64_t commands = 100000;  // menu commands in all, counting those adds and the final exit
+    uint32_t churn = 2;          // share of the roster added or removed at the start of each night
+    uint32_t attendance = 80;    // share of the roster whose chips are counted each night
+    uint32_t customPot = 30;     // chance a night's pot is typed in rather than the default
+    uint64_t reportEvery = 5000; // chip entries between winnings reports
+};
+
+// Writes the keystrokes the interactive menu would receive over a run of
+// poker nights: each night some players join and leave, the pot is set, the
+// players present have their chips counted, and winnings reports are asked
+// for along the way. Every draw comes from FastRng, so a seed gives the same
+// stream on every platform and release. Names are "player<n>".
+//
+// Counts are drawn so that once a night's chips are in, the roster's chips
+// (absent players keep their last counts) add up to the pot, as they would
+// at a real table.
+//
+// The menu only runs with at least one player loaded, so to pipe a stream
+// into it start from a players.txt holding `preloaded` players (one, unless
+// the profile says otherwise). They are never counted, but the default pot
+// includes their buy-ins.
+class WorkloadGenerator
+{
+public:
+    explicit WorkloadGenerator(const WorkloadProfile& profile)
+        : profile(profile), rng(profile.seed)
+    {
+    }
+
+    bool write(std::ostream& out)
+    {
+        remaining = profile.commands > 0 ? profile.commands - 1 : 0; // the exit is always written
+
+        for (uint64_t i = 0; i < profile.players && remaining > 0; i++)
+        {
+            add();
+            flushIfFull(out);
+        }
+
+        while (remaining > 0 && !live.empty())
+        {
+            night(out);
+        }
+
+        buffer += "6\n";
+        out.write(buffer.data(), buffer.size());
+        return static_cast<bool>(out.flush());
+    }
+
+private:
+    struct Seat
+    {
+        uint64_t id;
+        long long cents; // value of the chips last counted for them
+    };
+
+    void night(std::ostream& out)
+    {
+        uint64_t changes = std::max<uint64_t>(1, live.size() * profile.churn / 100);
+        for (uint64_t i = 0; i < changes && remaining > 0; i++)
+        {
+            if (live.size() > 1 && rng.bounded(2) == 0)
+            {
+                remove();
+            }
+            else
+            {
+                add();
+            }
+            flushIfFull(out);
+        }
+
+        // A partial shuffle picks who turned up, each counted once. Whatever
+        // the rest of the roster still holds is left out of their share.
+        uint64_t present = std::max<uint64_t>(1, live.size() * profile.attendance / 100);
+        long long presentCents = 0;
+        for (uint64_t i = 0; i < present; i++)
+        {
+            std::swap(live[i], live[i + rng.bounded(static_cast<uint32_t>(live.size() - i))]);
+            presentCents += live[i].cents;
+        }
+
+        long long shareCents = 0;
+        if (remaining > 0)
+        {
+            shareCents = setPot(heldCents - presentCents);
+        }
+
+        for (uint64_t i = 0; i < present && remaining > 0; i++)
+        {
+            // Each player takes up to twice an even split of what is left,
+            // and the last one counted takes the rest.
+            uint64_t left = present - i;
+            long long cents = shareCents;
+            if (left > 1)
+            {
+                uint64_t most = std::min<uint64_t>(2 * static_cast<uint64_t>(shareCents) / left, UINT32_MAX - 1);
+                cents = rng.bounded(static_cast<uint32_t>(most + 1));
+            }
+            shareCents -= cents;
+
+            countChips(live[i], cents);
+            if (++chipEntries % profile.reportEvery == 0 && remaining > 0)
+            {
+                report();
+            }
+            flushIfFull(out);
+        }
+
+        if (remaining > 0)
+        {
+            report();
+        }
+    }
+
+    void add()
+    {
+        live.push_back({ nextId++, 0 });
+        buffer += "1\n";
+        appendName(live.back().id);
+        remaining--;
+    }
+
+    void remove()
+    {
+        size_t index = rng.bounded(static_cast<uint32_t>(live.size()));
+        buffer += "2\n";
+        appendName(live[index].id);
+        heldCents -= live[index].cents;
+        live[index] = live.back();
+        live.pop_back();
+        remaining--;
+    }
+
+    // Sets the night's pot, typing one in when the default would be less
+    // than the absent players already hold. Returns what is left of it for
+    // the players present.
+    long long setPot(long long absentCents)
+    {
+        long long cents = static_cast<long long>(live.size() + profile.preloaded) * DEFAULT_POT_CENTS_PER_PLAYER;
+        if (rng.bounded(100) < profile.customPot || cents < absentCents)
+        {
+            cents = std::max(absentCents, cents + rng.bounded(10000) - 5000);
+            buffer += "5\n2\n";
+            appendNumber(cents / 100);
+            buffer += '.';
+            buffer += static_cast<char>('0' + cents % 100 / 10);
+            buffer += static_cast<char>('0' + cents % 10);
+            buffer += '\n';
+        }
+        else
+        {
+            buffer += "5\n1\n";
+        }
+        remaining--;
+
+        return cents - absentCents;
+    }
+
+    // Counts out a stack worth exactly the given amount, holding a few of
+    // each larger chip back as smaller ones so the mix varies.
+    void countChips(Seat& seat, long long cents)
+    {
+        heldCents += cents - seat.cents;
+        seat.cents = cents;
+
+        static constexpr long long CHIP_CENTS[5] = { 1, 5, 10, 25, 100 }; // white, red, blue, green, black
+        long long counts[5] = {};
+        for (int colour = 4; colour > 0; colour--)
+        {
+            counts[colour] = cents / CHIP_CENTS[colour];
+            counts[colour] -= rng.bounded(static_cast<uint32_t>(std::min(counts[colour], 4LL) + 1));
+            cents -= counts[colour] * CHIP_CENTS[colour];
+        }
+        counts[0] = cents;
+
+        buffer += "3\n";
+        appendName(seat.id);
+        for (long long count : counts)
+        {
+            appendNumber(static_cast<uint64_t>(count));
+            buffer += ' ';
+        }
+        buffer.back() = '\n';
+        remaining--;
+    }
+
+    // Mostly percentiles and top tens; the full listing now and then.
+    void report()
+    {
+        uint32_t kind = rng.bounded(100);
+        buffer += kind < 5 ? "4\n1\n" : kind < 30 ? "4\n2\n10\n" : "4\n3\n";
+        remaining--;
+    }
+
+    void appendName(uint64_t id)
+    {
+        buffer += "player";
+        appendNumber(id);
+        buffer += '\n';
+    }
+
+    void appendNumber(uint64_t value)
+    {
+        char digits[24];
+        auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, end);
+    }
+
+    void flushIfFull(std::ostream& out)
+    {
+        if (buffer.size() >= WORKLOAD_BUFFER_SIZE)
+        {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+
+    WorkloadProfile profile;
+    FastRng rng;
+    std::vector<Seat> live;
+    long long heldCents = 0; // chips counted for everyone in `live`
+    uint64_t nextId = 1;
+    uint64_t remaining = 0;
+    uint64_t chipEntries = 0;
+    std::string buffer;
+};
+
+// Reads a whole command-line number for --workload or --replay, naming the
+// argument in the error if it is not one.
+template <typename Number>
+bool parseWorkloadArgument(std::string_view text, const char* name, Number& value)
+{
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || error != std::errc() || end != text.data() + text.size())
+    {
+        std::cerr << "ERROR: '" << text << "' is not a valid " << name << "!" << '\n';
+        return false;
+    }
+
+    return true;
+}
+
+// --workload. "-" writes to standard output.
+inline bool writeWorkload(const WorkloadProfile& profile, const std::string& path)
+{
+    std::ofstream file;
+    if (path != "-")
+    {
+        file.open(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "ERROR: Unable to write '" << path << "'!" << '\n';
+            return false;
+        }
+    }
+
+    WorkloadGenerator generator(profile);
+    return generator.write(path == "-" ? std::cout : file);
+}
+
+// Latencies in log-linear buckets: 16 per power of two, so a percentile is
+// within 6.25% whatever the range, in a few kilobytes however many commands
+// are recorded.
+class LatencyHistogram
+{
+public:
+    void record(uint64_t nanoseconds)
+    {
+        counts[bucketOf(nanoseconds)]++;
+        total++;
+        maximum = std::max(maximum, nanoseconds);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t largest() const { return maximum; }
+
+    // The upper bound of the bucket holding the given fraction of samples.
+    uint64_t percentile(double fraction) const
+    {
+        uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * total));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < counts.size(); bucket++)
+        {
+            seen += counts[bucket];
+            if (seen >= rank && seen > 0)
+            {
+                return std::min(maximum, upperBoundOf(bucket));
+            }
+        }
+
+        return maximum;
+    }
+
+private:
+    static size_t bucketOf(uint64_t value)
+    {
+        if (value < 16)
+        {
+            return static_cast<size_t>(value);
+        }
+
+        int exponent = static_cast<int>(std::bit_width(value)) - 1;
+        return static_cast<size_t>((exponent - 3) * 16 + ((value >> (exponent - 4)) & 15));
+    }
+
+    static uint64_t upperBoundOf(size_t bucket)
+    {
+        if (bucket < 16)
+        {
+            return bucket;
+        }
+
+        int exponent = static_cast<int>(bucket / 16) + 3;
+        uint64_t lower = (16 + bucket % 16) << (exponent - 4);
+        return lower + (1ULL << (exponent - 4)) - 1;
+    }
+
+    std::vector<uint64_t> counts = std::vector<uint64_t>(61 * 16);
+    uint64_t total = 0;
+    uint64_t maximum = 0;
+};
+
+// Reads a menu command stream and turns each command into the ledger server
+// command with the same effect. Only the ledger commands (options 1 to 5 and
+// the exit) can be replayed.
+class MenuStreamReader
+{
+public:
+    explicit MenuStreamReader(std::istream& in)
+        : in(in)
+    {
+    }
+
+    // The next server command, with whether its reply is a LIST. Returns
+    // false at the end of the stream or on a command it cannot replay.
+    bool next(std::string& command, bool& list)
+    {
+        std::string_view option;
+        if (!word(option))
+        {
+            return false;
+        }
+
+        std::string_view argument;
+        std::string_view choice;
+        list = false;
+        command.clear();
+
+        if (option == "1" && word(argument))
+        {
+            command.append("ADD ").append(argument);
+        }
+        else if (option == "2" && word(argument))
+        {
+            command.append("REMOVE ").append(argument);
+        }
+        else if (option == "3" && word(argument))
+        {
+            command.append("CHIPS ").append(argument);
+            for (int colour = 0; colour < 5 && word(argument); colour++)
+            {
+                command.append(" ").append(argument);
+            }
+        }
+        else if (option == "4" && word(choice))
+        {
+            // The server has no top-N or percentile report; those read the total.
+            list = choice == "1";
+            command = list ? "LIST" : "TOTAL";
+            if (choice == "2")
+            {
+                word(argument);
+            }
+        }
+        else if (option == "5" && word(choice))
+        {
+            // The server sizes the default pot from its own roster, as the
+            // menu does, so players it started with are counted too.
+            command = "POT DEFAULT";
+            double dollars = 0.0;
+            if (choice == "2" && word(argument))
+            {
+                std::from_chars(argument.data(), argument.data() + argument.size(), dollars);
+                command = "POT " + std::to_string(std::llround(dollars * 100.0));
+            }
+        }
+        else if (option == "6")
+        {
+            command = "QUIT";
+        }
+        else
+        {
+            std::cerr << "ERROR: Cannot replay menu option " << option << "; only options 1 to 6 reach the ledger." << '\n';
+            failed = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool failed = false;
+
+private:
+    // The next whitespace-separated word, as the menu's std::cin >> reads it.
+    bool word(std::string_view& result)
+    {
+        while (true)
+        {
+            size_t start = buffer.find_first_not_of(" \t\r\n", position);
+            size_t end = start == std::string::npos ? std::string::npos : buffer.find_first_of(" \t\r\n", start);
+            if (end != std::string::npos || (start != std::string::npos && in.eof()))
+            {
+                end = std::min(end, buffer.size());
+                result = std::string_view(buffer).substr(start, end - start);
+                position = end;
+                return true;
+            }
+
+            if (in.eof())
+            {
+                return false;
+            }
+
+            // Keep the partial word and read more after it.
+            buffer.erase(0, start == std::string::npos ? buffer.size() : start);
+            position = 0;
+            size_t kept = buffer.size();
+            buffer.resize(kept + WORKLOAD_BUFFER_SIZE);
+            in.read(buffer.data() + kept, WORKLOAD_BUFFER_SIZE);
+            buffer.resize(kept + static_cast<size_t>(in.gcount()));
+        }
+    }
+
+    std::istream& in;
+    std::string buffer;
+    size_t position = 0;
+};
+
+// --replay. Sends a menu command stream to a running ledger server
+// (--serve), flat out or at a fixed rate in commands per second, keeping up
+// to REPLAY_WINDOW commands in flight. A command's latency runs from when
+// the schedule said to send it, not from when it was sent, so a server that
+// falls behind shows up in the tail rather than slowing the schedule down.
+inline bool runWorkloadReplay(const std::string& path, double commandsPerSecond, const std::string& socketPath)
+{
+#ifdef __linux__
+    std::ifstream file;
+    if (path != "-")
+    {
+        file.open(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "ERROR: Unable to open '" << path << "'!" << '\n';
+            return false;
+        }
+    }
+    MenuStreamReader reader(path == "-" ? std::cin : file);
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "ERROR: Socket path '" << socketPath << "' is too long!" << '\n';
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server < 0 || connect(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        std::cerr << "ERROR: Unable to connect to the ledger server on '" << socketPath << "': " << std::strerror(errno) << '\n';
+        if (server >= 0)
+        {
+            close(server);
+        }
+        return false;
+    }
+
+    struct InFlight
+    {
+        std::chrono::steady_clock::time_point due;
+        bool list;
+    };
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    std::deque<InFlight> inFlight;
+    std::string output;
+    std::string input;
+    std::string command;
+    LatencyHistogram latencies;
+    uint64_t sent = 0;
+    uint64_t errors = 0;
+    long long listLinesLeft = 0;
+    bool streamEnded = false;
+    bool hungUp = false;
+
+    auto dueTime = [&](uint64_t index)
+    {
+        return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(index / commandsPerSecond));
+    };
+
+    while (!(streamEnded && inFlight.empty()) && !hungUp)
+    {
+        Clock::time_point now = Clock::now();
+        while (!streamEnded && inFlight.size() < REPLAY_WINDOW && (commandsPerSecond <= 0 || dueTime(sent) <= now))
+        {
+            bool list = false;
+            if (!reader.next(command, list))
+            {
+                streamEnded = true;
+                break;
+            }
+
+            output.append(command).append("\n");
+            inFlight.push_back({ commandsPerSecond > 0 ? dueTime(sent) : now, list });
+            sent++;
+        }
+
+        // Sleep until the next command is due, to the nanosecond.
+        timespec timeout = {};
+        bool waitForDue = !streamEnded && inFlight.size() < REPLAY_WINDOW && commandsPerSecond > 0;
+        if (waitForDue)
+        {
+            long long wait = std::max<long long>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(dueTime(sent) - Clock::now()).count());
+            timeout.tv_sec = static_cast<time_t>(wait / 1000000000);
+            timeout.tv_nsec = static_cast<long>(wait % 1000000000);
+        }
+
+        pollfd ready = { server, static_cast<short>(POLLIN | (output.empty() ? 0 : POLLOUT)), 0 };
+        if (ppoll(&ready, 1, waitForDue ? &timeout : nullptr, nullptr) < 0 && errno != EINTR)
+        {
+            std::cerr << "ERROR: ppoll failed: " << std::strerror(errno) << '\n';
+            break;
+        }
+
+        if ((ready.revents & POLLOUT) != 0)
+        {
+            ssize_t written = send(server, output.data(), output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (written > 0)
+            {
+                output.erase(0, static_cast<size_t>(written));
+            }
+        }
+
+        if ((ready.revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+        {
+            char received[LEDGER_READ_SIZE];
+            ssize_t count = recv(server, received, sizeof(received), MSG_DONTWAIT);
+            if (count <= 0 && !(count < 0 && (errno == EAGAIN || errno == EINTR)))
+            {
+                hungUp = true;
+            }
+            input.append(received, static_cast<size_t>(std::max<ssize_t>(0, count)));
+
+            size_t lineStart = 0;
+            Clock::time_point arrived = Clock::now();
+            for (size_t end = input.find('\n'); end != std::string::npos && !inFlight.empty(); end = input.find('\n', lineStart))
+            {
+                std::string_view line = std::string_view(input).substr(lineStart, end - lineStart);
+                lineStart = end + 1;
+
+                if (listLinesLeft > 0)
+                {
+                    listLinesLeft--;
+                }
+                else if (inFlight.front().list && line.rfind("OK ", 0) == 0)
+                {
+                    std::from_chars(line.data() + 3, line.data() + line.size(), listLinesLeft);
+                }
+                else
+                {
+                    errors += line.rfind("ERR", 0) == 0 ? 1 : 0;
+                }
+
+                if (listLinesLeft == 0)
+                {
+                    latencies.record(static_cast<uint64_t>(std::max<long long>(0,
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(arrived - inFlight.front().due).count())));
+                    inFlight.pop_front();
+                }
+            }
+            input.erase(0, lineStart);
+        }
+    }
+    close(server);
+
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    auto microseconds = [&](double fraction) { return latencies.percentile(fraction) / 1000.0; };
+
+    std::cout << "Replayed " << latencies.count() << " commands (" << errors << " errors) in " << elapsed.count()
+        << "s: " << latencies.count() / std::max(elapsed.count(), 1e-9) << " commands/s." << '\n';
+    std::cout << "Latency p50 " << microseconds(0.5) << "us, p90 " << microseconds(0.9) << "us, p99 " << microseconds(0.99)
+        << "us, p99.9 " << microseconds(0.999) << "us, max " << latencies.largest() / 1000.0 << "us." << '\n';
+
+    if (!inFlight.empty())
+    {
+        std::cerr << "ERROR: The ledger server hung up with " << inFlight.size() << " commands unanswered!" << '\n';
+        return false;
+    }
+
+    return !reader.failed;
+#else
+    std::cerr << "ERROR: Replaying a workload needs Linux (Unix domain sockets)." << '\n';
+    return false;
+#endif
+}